@@ -1,6 +1,7 @@
 #version 430 core
 
-layout (location = 0) in vec3 position;
+layout (location = 0) in dvec2 position;
+layout (location = 3) uniform float scale;
 void main() {
-    gl_Position = vec4(position.x, position.y, position.z, 1.0);
-}
\ No newline at end of file
+    gl_Position = vec4(vec2(position) * scale, 0.0, 1.0);
+}
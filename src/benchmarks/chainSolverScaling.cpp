@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "../calculations/BeamElement.hpp"
+#include "../calculations/blockTridiagonalSolver.hpp"
+#include "../calculations/connectivity.hpp"
+#include "../calculations/tangent.hpp"
+#include "../utils/arch.hpp"
+
+/*
+ * Scaling of the block tridiagonal solver with the number of threads, on the linear tangent of a long arch.
+ * Every thread count gets as many segments, the best of several repetitions is reported.
+ * usage: chainSolverScaling [elementCount] [maxThreads]
+ */
+int main(int argc, char **argv) {
+    const unsigned int elementCount = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    unsigned int maxThreads = 1;
+#ifdef _OPENMP
+    maxThreads = static_cast<unsigned int>(omp_get_max_threads());
+#endif
+    if (argc > 2) maxThreads = std::stoul(argv[2]);
+    const int repetitions = 5;
+
+    CircleExpression expression(1000, 400);
+    const auto vertices = calculateArch(elementCount, &expression);
+    const auto connectivity = chainConnectivity(elementCount + 1);
+    const auto maps = mapDegreesOfFreedom(connectivity);
+    const auto degreesOfFreedom = 3 * (elementCount + 1);
+    // Pinned at both ends
+    std::vector<bool> constrained(degreesOfFreedom, false);
+    constrained[0] = constrained[1] = constrained[degreesOfFreedom - 3] = constrained[degreesOfFreedom - 2] = true;
+
+    Tangent tangent(degreesOfFreedom, constrained);
+    const ElementProperties properties{2.1e5, 10, 4166};
+    // Largest element stiffness, which bounds the norm of the tangent up to a small factor
+    double stiffnessNorm = 0;
+    for (unsigned int i = 0; i < elementCount; ++i) {
+        const auto &nodes = connectivity[i];
+        const BeamElement element{{vertices[2 * nodes.first], vertices[2 * nodes.first + 1]},
+                                  {vertices[2 * nodes.second], vertices[2 * nodes.second + 1]}, properties, i};
+        tangent.addElement(maps[i]);
+        tangent.setElementStiffness(i, element.calculateMaterialStiffness());
+        stiffnessNorm = std::max(stiffnessNorm, tangent.elementStiffness(i).norm());
+    }
+    Eigen::VectorXd load = Eigen::VectorXd::Zero(degreesOfFreedom);
+    for (unsigned int node = 0; node <= elementCount; ++node) load(3 * node + 1) = -1;
+    for (size_t i = 0; i < degreesOfFreedom; ++i) {
+        if (constrained[i]) load(i) = 0;
+    }
+
+    printf("%u elements, %u degrees of freedom\n", elementCount, degreesOfFreedom);
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+    double serialTime = 0;
+    for (auto threads : threadCounts) {
+#ifdef _OPENMP
+        omp_set_num_threads(static_cast<int>(threads));
+#endif
+        BlockTridiagonalSolver solver(threads);
+        double factorizeTime = 1e300, solveTime = 1e300;
+        Eigen::VectorXd displacement;
+        for (int repetition = 0; repetition < repetitions; ++repetition) {
+            const auto start = std::chrono::steady_clock::now();
+            solver.factorize(tangent);
+            const auto factorized = std::chrono::steady_clock::now();
+            displacement = solver.solve(load);
+            const auto solved = std::chrono::steady_clock::now();
+            factorizeTime = std::min(factorizeTime, std::chrono::duration<double, std::milli>(factorized - start).count());
+            solveTime = std::min(solveTime, std::chrono::duration<double, std::milli>(solved - factorized).count());
+        }
+        if (threads == 1) serialTime = factorizeTime + solveTime;
+        // The tangent of a long chain is badly conditioned, so the residual is measured relative to |K| |x|
+        const double residual = (tangent.apply(displacement) - load).norm() / (stiffnessNorm * displacement.norm());
+        printf("%2u threads: factorize %8.1f ms, solve %7.1f ms, speedup %5.2f, backward error %.1e\n",
+               threads, factorizeTime, solveTime, serialTime / (factorizeTime + solveTime), residual);
+    }
+}
@@ -0,0 +1,95 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../calculations/structure.hpp"
+#include "../utils/arch.hpp"
+
+// The structures log here, the directory is removed when the benchmark ends
+const std::filesystem::path LOG_DIRECTORY = std::filesystem::temp_directory_path() / "sfemsElementConvergence";
+
+/*
+ * The loading parameter of the first critical point of the pinned arch of resources/config.yaml under its load at
+ * the top. The path is followed in load steps of a twentieth of the load and the critical point is localized within
+ * 1e-9 of the load, far below the discretization errors.
+ */
+double archCriticalLoad(unsigned int elementCount, ElementType type) {
+    CircleExpression expression(1000, 400);
+    const auto vertices = calculateArch(elementCount, &expression);
+    const int degreesOfFreedom = 3 * static_cast<int>(elementCount + 1);
+    const std::vector<BoundaryCondition> boundaryConditions{
+            {0, 0}, {1, 0}, {degreesOfFreedom - 3, 0}, {degreesOfFreedom - 2, 0}};
+    const std::vector<Force> forces{{ForceType::GLOBAL, static_cast<int>(elementCount / 2), 1, -14000}};
+    ElementProperties properties{2.1e5, 10, 4166};
+    properties.type = type;
+    Structure structure(vertices, properties, boundaryConditions, forces,
+                        Logger(elementCount / 2, 1, (LOG_DIRECTORY / "").string()),
+                        std::make_unique<SparseDirectSolver>());
+    const double stepSize = 0.05;
+    structure.setCriticalPointTolerance(1e-9 / stepSize);
+    // The arch of the config buckles at about 0.8 times the load
+    for (int increment = 0; increment < 40; ++increment) {
+        if (structure.newton(stepSize, 1e-3, 100)) break;
+        const auto &point = structure.getLastCriticalPoint();
+        if (point.type == CriticalPoint::NONE) continue;
+        if (point.mode.size() == 0) throw std::runtime_error("The critical point of the arch was not localized");
+        return point.loadingParameter;
+    }
+    throw std::runtime_error("The arch diverged before its first critical point");
+}
+
+/*
+ * Convergence of the first critical load of the arch along its nonlinear path with the linear and the higher order
+ * element. The reference comes from the linear element alone, on two meshes two and four times finer than the
+ * finest one, extrapolated with its second order convergence (Richardson), so the higher order element is not
+ * measured against itself. Much finer meshes do not converge to the residual tolerance, the round-off of the inner
+ * forces grows with the stiffness of the short elements.
+ * Shows how many degrees of freedom each element needs for a given accuracy, an even element count keeps the
+ * load on a node.
+ * usage: elementConvergence [maxElements]
+ */
+int main(int argc, char **argv) {
+    const unsigned int maxElements = argc > 1 ? std::stoul(argv[1]) : 256;
+    std::filesystem::create_directories(LOG_DIRECTORY);
+    const double coarseReference = archCriticalLoad(2 * maxElements, ElementType::LINEAR);
+    const double fineReference = archCriticalLoad(4 * maxElements, ElementType::LINEAR);
+    const double reference = (4 * fineReference - coarseReference) / 3;
+    printf("Reference critical load %.8f times the nominal load, extrapolated from the linear element on %u and %u "
+           "elements (%.8f, %.8f)\n", reference, 2 * maxElements, 4 * maxElements, coarseReference, fineReference);
+
+    const std::vector<double> accuracies{1e-2, 1e-3, 1e-4};
+    const std::pair<ElementType, const char *> types[] = {{ElementType::LINEAR,       "linear"},
+                                                          {ElementType::HIGHER_ORDER, "higher order"}};
+    // Fewest degrees of freedom that reach every accuracy, 0 if none of the meshes does
+    std::vector<std::vector<unsigned int>> needed(2, std::vector<unsigned int>(accuracies.size(), 0));
+    printf("%8s %8s %14s %14s %14s %14s\n", "elements", "dofs", "linear", "error", "higher order", "error");
+    for (unsigned int elementCount = 4; elementCount <= maxElements; elementCount *= 2) {
+        const unsigned int degreesOfFreedom = 3 * (elementCount + 1);
+        // Both loads first, the structure prints while it is set up
+        double loads[2], errors[2];
+        for (int t = 0; t < 2; ++t) {
+            loads[t] = archCriticalLoad(elementCount, types[t].first);
+            errors[t] = std::abs(loads[t] - reference) / reference;
+            for (size_t a = 0; a < accuracies.size(); ++a) {
+                if (errors[t] < accuracies[a] && needed[t][a] == 0) needed[t][a] = degreesOfFreedom;
+            }
+        }
+        printf("%8u %8u %14.8f %14.2e %14.8f %14.2e\n", elementCount, degreesOfFreedom,
+               loads[0], errors[0], loads[1], errors[1]);
+    }
+
+    printf("Degrees of freedom for a relative error below\n");
+    for (size_t a = 0; a < accuracies.size(); ++a) {
+        printf("%8.0e:", accuracies[a]);
+        for (int t = 0; t < 2; ++t) {
+            if (needed[t][a] > 0) printf(" %s %u", types[t].second, needed[t][a]);
+            else printf(" %s more than %u", types[t].second, 3 * (maxElements + 1));
+        }
+        printf("\n");
+    }
+    std::filesystem::remove_all(LOG_DIRECTORY);
+}
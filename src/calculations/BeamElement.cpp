@@ -1,7 +1,7 @@
 #include <iostream>
 #include "BeamElement.hpp"
 
-Eigen::Matrix<double, 6, 6> BeamElement::calculateLocalToGlobalRotationMatrix() const {
+Eigen::Matrix<double, 6, 6> CorotationalBeam::calculateLocalToGlobalRotationMatrix() const {
     Eigen::Matrix<double, 6, 6> localToGlobalTransformation;
     localToGlobalTransformation <<
      deformedBeamUnitTangent[0], -deformedBeamUnitTangent[1],  0,               0,                           0,              0,
@@ -13,20 +13,17 @@ Eigen::Matrix<double, 6, 6> BeamElement::calculateLocalToGlobalRotationMatrix()
     return localToGlobalTransformation;
 }
 
-const Eigen::Matrix<double, 6, 6>
+const Eigen::Matrix3d
 BeamElement::calculateLocalStiffness(const double L, const double E, const double A, const double I) const {
-    Eigen::Matrix<double, 6, 6> localStiffness;
+    Eigen::Matrix3d localStiffness;
     localStiffness <<
-     E*A/L,  0,                0,              -E*A/L,  0,                0,
-     0,      12*E*I/pow(L,3),  6*E*I/pow(L,2),  0,     -12*E*I/pow(L,3),  6*E*I/pow(L,2),
-     0,      6*E*I/pow(L,2),   4*E*I/L,         0,     -6*E*I/pow(L,2),   2*E*I/L,
-    -E*A/L,  0,                0,               E*A/L,  0,                0,
-     0,     -12*E*I/pow(L,3), -6*E*I/pow(L,2),  0,      12*E*I/pow(L,3), -6*E*I/pow(L,2),
-     0,      6*E*I/pow(L,2),   2*E*I/L,         0,     -6*E*I/pow(L,2),   4*E*I/L;
+     E*A/L,  0,        0,
+     0,      4*E*I/L,  2*E*I/L,
+     0,      2*E*I/L,  4*E*I/L;
     return localStiffness;
 }
 
-Eigen::Vector2d BeamElement::calculateNodeUnitVector(double nodeAngle) const {
+Eigen::Vector2d CorotationalBeam::calculateNodeUnitVector(double nodeAngle) const {
     Eigen::Matrix2d rotationMatrixFromInitialToDeformedCoordinateSystem{};
     rotationMatrixFromInitialToDeformedCoordinateSystem <<
             std::cos(nodeAngle), -std::sin(nodeAngle),
@@ -36,27 +33,48 @@ Eigen::Vector2d BeamElement::calculateNodeUnitVector(double nodeAngle) const {
 }
 
 Eigen::Matrix<double, 6, 6> BeamElement::calculateMaterialStiffness() const {
+    const Eigen::Matrix<double, 3, 6> map = calculateLocalDeformationMap();
     Eigen::Matrix<double, 6, 6> globalStiffness{
-            localToGlobalRotationMatrix * localStiffness * localToGlobalRotationMatrix.transpose()
+            localToGlobalRotationMatrix * map.transpose() * localStiffness * map *
+            localToGlobalRotationMatrix.transpose()
     };
     return globalStiffness;
 }
 
-Eigen::Matrix<double, 6, 1> BeamElement::calculateInnerForces() {
+Eigen::Vector2d CorotationalBeam::calculateChordRotations() const {
     Eigen::Vector2d deformationUnitNormal;
     deformationUnitNormal << -deformedBeamUnitTangent(1), deformedBeamUnitTangent(0);
 
-    auto theta1 = std::asin(nodeOneVector.transpose() * deformationUnitNormal);
-    auto theta2 = std::asin(nodeTwoVector.transpose() * deformationUnitNormal);
+    return Eigen::Vector2d{
+            std::asin(nodeOneVector.transpose() * deformationUnitNormal),
+            std::asin(nodeTwoVector.transpose() * deformationUnitNormal)
+    };
+}
+
+Eigen::Matrix<double, 3, 6> CorotationalBeam::calculateLocalDeformationMap() const {
+    // The chord turns with the transverse displacements over its deformed length
+    const auto L = beamLength + lengthDeformation;
+    Eigen::Matrix<double, 3, 6> map;
+    map <<
+        -1, 0,   0, 1,  0,   0,
+         0, 1/L, 1, 0, -1/L, 0,
+         0, 1/L, 0, 0, -1/L, 1;
+    return map;
+}
+
+void CorotationalBeam::setInnerForces(const Eigen::Vector3d &forces) {
+    innerForces = calculateLocalDeformationMap().transpose() * forces;
+}
+
+Eigen::Matrix<double, 6, 1> BeamElement::calculateInnerForces() {
+    const Eigen::Vector2d theta = calculateChordRotations();
 
-    Eigen::Matrix<double, 6, 1> localDeformation;
-    localDeformation << -lengthDeformation / 2, 0, theta1, lengthDeformation / 2, 0, theta2;
-    innerForces = localStiffness * localDeformation;
+    setInnerForces(localStiffness * Eigen::Vector3d{lengthDeformation, theta(0), theta(1)});
     Eigen::Matrix<double, 6, 1> forces = localToGlobalRotationMatrix * innerForces;
     return forces;
 }
 
-void BeamElement::updateDeformation(const Eigen::Matrix<double, 6, 1> &displacement) {
+void CorotationalBeam::updateDeformation(const Eigen::Matrix<double, 6, 1> &displacement) {
     auto deformationVector = Eigen::Vector2d{
             displacement(3) - displacement(0),
             displacement(4) - displacement(1)
@@ -72,14 +90,14 @@ void BeamElement::updateDeformation(const Eigen::Matrix<double, 6, 1> &displacem
     localToGlobalRotationMatrix = calculateLocalToGlobalRotationMatrix();
 }
 
-Eigen::Matrix<double, 6, 6> BeamElement::calculateGeometricStiffness() const {
+Eigen::Matrix<double, 6, 6> CorotationalBeam::calculateChordGeometricStiffness() const {
     auto L = beamLength + lengthDeformation;
     auto N = innerForces(3);
     auto V = innerForces(4);
     Eigen::Matrix<double, 3, 3> quadrant;
     quadrant <<
-             0,       -V/(2*L), 0,
-            -V/(2*L),  N/L,     0,
+             0,    -V/L, 0,
+            -V/L,   N/L, 0,
              0,        0,       0;
     Eigen::Matrix<double, 6, 6> geometricStiffness;
     geometricStiffness <<
@@ -88,6 +106,21 @@ Eigen::Matrix<double, 6, 6> BeamElement::calculateGeometricStiffness() const {
     return localToGlobalRotationMatrix * geometricStiffness * localToGlobalRotationMatrix.transpose();
 }
 
-Eigen::Matrix<double, 6, 6> BeamElement::calculateTotalStiffness() const {
-    return calculateMaterialStiffness() + calculateGeometricStiffness();
+Eigen::Matrix<double, 6, 6> CorotationalBeam::calculateMass(MassType type) const {
+    const auto L = beamLength;
+    Eigen::Matrix<double, 6, 6> localMass;
+    if (type == MassType::LUMPED) {
+        localMass = Eigen::Matrix<double, 6, 6>::Zero();
+        localMass.diagonal() << mass/2, mass/2, mass*L*L/78, mass/2, mass/2, mass*L*L/78;
+        return localMass;
+    }
+    localMass <<
+     140,  0,      0,       70,   0,      0,
+     0,    156,    22*L,    0,    54,    -13*L,
+     0,    22*L,   4*L*L,   0,    13*L,  -3*L*L,
+     70,   0,      0,       140,  0,      0,
+     0,    54,     13*L,    0,    156,   -22*L,
+     0,   -13*L,  -3*L*L,   0,   -22*L,   4*L*L;
+    localMass *= mass / 420;
+    return localToGlobalRotationMatrix * localMass * localToGlobalRotationMatrix.transpose();
 }
@@ -3,12 +3,35 @@
 
 #include <Eigen/Dense>
 
+enum class ElementType {
+    // Linear elastic in the corotated element coordinates, see BeamElement
+    LINEAR,
+    // Second order in the corotated element coordinates, see HigherOrderBeamElement
+    HIGHER_ORDER
+};
+
 struct ElementProperties {
     double youngsModulus, crossSectionArea, momentOfIntertia;
+    // Mass per volume, only needed for modal analysis and dynamics
+    double density = 0;
+    ElementType type = ElementType::LINEAR;
 };
 
-class BeamElement {
-private:
+enum class MassType {
+    // Diagonal, the rotational inertia is scaled from the consistent mass (HRZ lumping)
+    LUMPED,
+    // From the same cubic shape functions as the stiffness
+    CONSISTENT
+};
+
+/*
+ * A corotational beam: the rigid motion of the element is removed by following its deformed chord,
+ * what is left are the elongation and the end rotations relative to the chord.
+ * This is the part all element types share, without virtual functions so the element loops of a structure
+ * call the element functions directly, see CorotationalElement.
+ */
+class CorotationalBeam {
+protected:
     const Eigen::Vector2d beamVector;
     const double beamLength;
     double lengthDeformation = 0;
@@ -18,26 +41,33 @@ private:
     Eigen::Vector2d nodeOneVector = Eigen::Vector2d::Zero();
     Eigen::Vector2d nodeTwoVector = Eigen::Vector2d::Zero();
 
-    Eigen::Matrix<double, 6, 1> innerForces;
+    // Inner forces in the corotated element coordinates, set by calculateInnerForces of the element type
+    Eigen::Matrix<double, 6, 1> innerForces = Eigen::Matrix<double, 6, 1>::Zero();
 
-    const Eigen::Matrix<double, 6, 6> localStiffness;
+    const double mass;
 
-    const Eigen::Matrix<double, 6, 6>
-    calculateLocalStiffness(double L, double E, double A, double I) const;
+    // The end rotations relative to the deformed chord
+    Eigen::Vector2d calculateChordRotations() const;
+
+    // The change of the elongation and of the end rotations relative to the chord with the local displacements
+    Eigen::Matrix<double, 3, 6> calculateLocalDeformationMap() const;
+
+    // Keeps the inner forces of the normal force and the end moments, the shear balances the moments
+    void setInnerForces(const Eigen::Vector3d &forces);
 
     Eigen::Vector2d calculateNodeUnitVector(double nodeAngle) const;
 
     Eigen::Matrix<double, 6, 6> calculateLocalToGlobalRotationMatrix() const;
 
-    Eigen::Matrix<double, 6, 6> calculateMaterialStiffness() const;
-
-    Eigen::Matrix<double, 6, 6> calculateGeometricStiffness() const;
+    // The stiffness from the rotation and stretching of the chord under the inner forces of the last
+    // calculateInnerForces, the exact derivative of the inner forces together with the material stiffness
+    Eigen::Matrix<double, 6, 6> calculateChordGeometricStiffness() const;
 
 public:
     const unsigned int index;
     Eigen::Matrix<double, 6, 6> localToGlobalRotationMatrix;
 
-    BeamElement(
+    CorotationalBeam(
             const Eigen::Vector2d &firstCoordinate,
             const Eigen::Vector2d &secondCoordinate,
                 const ElementProperties &properties,
@@ -49,19 +79,66 @@ public:
             beamUnitVector(beamVector / beamLength),
             deformedBeamUnitTangent(beamUnitVector),
             beamUnitNormalVector(-beamUnitVector(1), beamUnitVector(0)),
+            mass(properties.density * properties.crossSectionArea * beamLength),
+            localToGlobalRotationMatrix(calculateLocalToGlobalRotationMatrix()) {}
+
+    void updateDeformation(const Eigen::Matrix<double, 6, 1> &displacement);
+
+    // The inner forces of the last calculateInnerForces in the corotated element coordinates
+    const Eigen::Matrix<double, 6, 1> &getLocalInnerForces() const { return innerForces; }
+
+    Eigen::Matrix<double, 6, 6> calculateMass(MassType type) const;
+};
+
+/*
+ * Base of the element types (CRTP): Element has
+ *   Eigen::Matrix<double, 6, 1> calculateInnerForces(), the global inner forces, which also keeps the local ones
+ *   Eigen::Matrix<double, 6, 6> calculateMaterialStiffness() const
+ *   Eigen::Matrix<double, 6, 6> calculateGeometricStiffness() const, with the inner forces of calculateInnerForces
+ * and gets everything else from here, resolved at compile time.
+ */
+template<typename Element>
+class CorotationalElement : public CorotationalBeam {
+public:
+    using CorotationalBeam::CorotationalBeam;
+
+    Eigen::Matrix<double, 6, 6> calculateTotalStiffness() const {
+        const auto &element = static_cast<const Element &>(*this);
+        return element.calculateMaterialStiffness() + element.calculateGeometricStiffness();
+    }
+};
+
+/*
+ * The corotational beam that is linear elastic in the element coordinates
+ */
+class BeamElement final : public CorotationalElement<BeamElement> {
+    // Stiffness of (elongation, theta1, theta2)
+    const Eigen::Matrix3d localStiffness;
+
+    const Eigen::Matrix3d
+    calculateLocalStiffness(double L, double E, double A, double I) const;
+
+public:
+    BeamElement(
+            const Eigen::Vector2d &firstCoordinate,
+            const Eigen::Vector2d &secondCoordinate,
+                const ElementProperties &properties,
+                const unsigned int index
+    ) :
+            CorotationalElement(firstCoordinate, secondCoordinate, properties, index),
             localStiffness(calculateLocalStiffness(
                     beamLength,
                     properties.youngsModulus,
                     properties.crossSectionArea,
                     properties.momentOfIntertia
-            )),
-            localToGlobalRotationMatrix(calculateLocalToGlobalRotationMatrix()) {}
-
-    void updateDeformation(const Eigen::Matrix<double, 6, 1> &displacement);
+            )) {}
 
     Eigen::Matrix<double, 6, 1> calculateInnerForces();
 
-    Eigen::Matrix<double, 6, 6> calculateTotalStiffness() const;
+    Eigen::Matrix<double, 6, 6> calculateMaterialStiffness() const;
+
+    // Uses the inner forces of the last calculateInnerForces
+    Eigen::Matrix<double, 6, 6> calculateGeometricStiffness() const { return calculateChordGeometricStiffness(); }
 
 };
 
@@ -0,0 +1,127 @@
+#include <cmath>
+#include "HigherOrderBeamElement.hpp"
+
+// Gauss-Legendre points and weights on [0, 1]. Exact for the bending energy, the membrane energy is underintegrated
+// on purpose: that leaves a constant axial force and keeps curved elements from locking in inextensional bending
+const double GAUSS_POINTS[2] = {0.21132486540518713, 0.78867513459481287};
+const double GAUSS_WEIGHTS[2] = {0.5, 0.5};
+// Largest turn between two elements at a node of a smooth member, larger turns are corners of a frame
+const double SMOOTH_ANGLE = M_PI / 4;
+
+HigherOrderBeamElement::HigherOrderBeamElement(const Eigen::Vector2d &firstCoordinate,
+                                               const Eigen::Vector2d &secondCoordinate,
+                                               const ElementProperties &properties, unsigned int index,
+                                               const Eigen::Vector2d &initialSlopes) :
+        CorotationalElement(firstCoordinate, secondCoordinate, properties, index),
+        axialStiffness(properties.youngsModulus * properties.crossSectionArea),
+        bendingStiffness(properties.youngsModulus * properties.momentOfIntertia),
+        initialSlopes(initialSlopes) {
+    // The undeformed stiffness, which couples stretching and bending for a curved element
+    calculateInnerForces();
+}
+
+Eigen::Matrix<double, 6, 1> HigherOrderBeamElement::calculateInnerForces() {
+    // The slopes of the deformed element relative to its chord, and their change
+    const Eigen::Vector2d slopeChange = calculateChordRotations();
+    const Eigen::Vector2d theta = initialSlopes + slopeChange;
+    const auto L = beamLength;
+    // The slope w' along the element per end rotation, and its derivative along xi
+    auto slopes = [](double xi) { return Eigen::Vector2d{(1 - xi) * (1 - 3 * xi), xi * (3 * xi - 2)}; };
+    auto slopeDerivatives = [](double xi) { return Eigen::Vector2d{6 * xi - 4, 6 * xi - 2}; };
+
+    // The axial displacement of the internal node beyond the linear one, where the force on it vanishes.
+    // The strain is linear in it, so with the same quadrature this is exact:
+    // a = -3L/8 * sum (1 - 2 xi) (w'^2 - w0'^2)
+    double internal = 0;
+    for (int i = 0; i < 2; ++i) {
+        const double xi = GAUSS_POINTS[i];
+        const double slope = slopes(xi).dot(theta);
+        const double initialSlope = slopes(xi).dot(initialSlopes);
+        internal -= 3 * L / 8 * GAUSS_WEIGHTS[i] * (1 - 2 * xi) * (slope * slope - initialSlope * initialSlope);
+    }
+
+    // Forces and stiffness of (elongation, theta1, theta2, internal)
+    Eigen::Vector4d forces = Eigen::Vector4d::Zero();
+    Eigen::Matrix4d stiffness = Eigen::Matrix4d::Zero();
+    localGeometricStiffness.setZero();
+    for (int i = 0; i < 2; ++i) {
+        const double xi = GAUSS_POINTS[i];
+        const Eigen::Vector2d g = slopes(xi);
+        const Eigen::Vector2d dg = slopeDerivatives(xi);
+        const double slope = g.dot(theta);
+        const double initialSlope = g.dot(initialSlopes);
+        const double strain = lengthDeformation / L + 4 * (1 - 2 * xi) * internal / L +
+                              (slope * slope - initialSlope * initialSlope) / 2;
+        const double curvature = dg.dot(slopeChange) / L;
+        const Eigen::Vector4d strainGradient{1 / L, slope * g(0), slope * g(1), 4 * (1 - 2 * xi) / L};
+        const Eigen::Vector4d curvatureGradient{0, dg(0) / L, dg(1) / L, 0};
+        const double weight = L * GAUSS_WEIGHTS[i];
+        forces += weight * (axialStiffness * strain * strainGradient + bendingStiffness * curvature * curvatureGradient);
+        stiffness += weight * (axialStiffness * strainGradient * strainGradient.transpose() +
+                               bendingStiffness * curvatureGradient * curvatureGradient.transpose());
+        localGeometricStiffness.bottomRightCorner<2, 2>() += weight * axialStiffness * strain * g * g.transpose();
+    }
+    localMaterialStiffness = stiffness.topLeftCorner<3, 3>() -
+                             stiffness.topRightCorner<3, 1>() * stiffness.bottomLeftCorner<1, 3>() / stiffness(3, 3);
+
+    setInnerForces(forces.head<3>());
+    return localToGlobalRotationMatrix * innerForces;
+}
+
+Eigen::Matrix<double, 6, 6> HigherOrderBeamElement::calculateMaterialStiffness() const {
+    const Eigen::Matrix<double, 3, 6> map = calculateLocalDeformationMap();
+    return localToGlobalRotationMatrix * map.transpose() * localMaterialStiffness * map *
+           localToGlobalRotationMatrix.transpose();
+}
+
+Eigen::Matrix<double, 6, 6> HigherOrderBeamElement::calculateGeometricStiffness() const {
+    const Eigen::Matrix<double, 3, 6> map = calculateLocalDeformationMap();
+    return calculateChordGeometricStiffness() +
+           localToGlobalRotationMatrix * map.transpose() * localGeometricStiffness * map *
+           localToGlobalRotationMatrix.transpose();
+}
+
+std::vector<Eigen::Vector2d> calculateInitialSlopes(const std::vector<double> &vertices,
+                                                    const std::vector<ElementNodes> &connectivity) {
+    const size_t nodeCount = vertices.size() / 2;
+    auto vertex = [&vertices](unsigned int node) {
+        return Eigen::Vector2d{vertices[2 * node], vertices[2 * node + 1]};
+    };
+    std::vector<std::vector<unsigned int>> nodeElements(nodeCount);
+    for (unsigned int e = 0; e < connectivity.size(); ++e) {
+        nodeElements[connectivity[e].first].push_back(e);
+        nodeElements[connectivity[e].second].push_back(e);
+    }
+
+    // The unit tangent of the circle through a node and its two neighbours, zero where the member has a corner
+    std::vector<Eigen::Vector2d> tangents(nodeCount, Eigen::Vector2d::Zero());
+    for (unsigned int node = 0; node < nodeCount; ++node) {
+        if (nodeElements[node].size() != 2) continue;
+        auto otherEnd = [&](unsigned int e) {
+            return connectivity[e].first == node ? connectivity[e].second : connectivity[e].first;
+        };
+        const Eigen::Vector2d a = vertex(node) - vertex(otherEnd(nodeElements[node][0]));
+        const Eigen::Vector2d b = vertex(otherEnd(nodeElements[node][1])) - vertex(node);
+        const double turn = std::atan2(a(0) * b(1) - a(1) * b(0), a.dot(b));
+        if (std::abs(turn) > SMOOTH_ANGLE) continue;
+        // The tangent is turned from the chord before the node by half the angle the circle turns along it
+        const double curvature = 2 * std::sin(turn) / (a + b).norm();
+        const double halfAngle = std::asin(std::max(-1.0, std::min(curvature * a.norm() / 2, 1.0)));
+        tangents[node] = Eigen::Rotation2Dd(halfAngle) * a.normalized();
+    }
+
+    std::vector<Eigen::Vector2d> initialSlopes(connectivity.size());
+    for (size_t e = 0; e < connectivity.size(); ++e) {
+        const Eigen::Vector2d chord = (vertex(connectivity[e].second) - vertex(connectivity[e].first)).normalized();
+        auto slope = [&chord](Eigen::Vector2d tangent) {
+            if (tangent.dot(chord) < 0) tangent = -tangent;
+            return std::atan2(chord(0) * tangent(1) - chord(1) * tangent(0), chord.dot(tangent));
+        };
+        const Eigen::Vector2d &first = tangents[connectivity[e].first], &second = tangents[connectivity[e].second];
+        initialSlopes[e] = {slope(first), slope(second)};
+        // At a corner or a free end the element is a circular arc, whose end slopes are opposite
+        if (first.isZero()) initialSlopes[e](0) = -initialSlopes[e](1);
+        if (second.isZero()) initialSlopes[e](1) = -initialSlopes[e](0);
+    }
+    return initialSlopes;
+}
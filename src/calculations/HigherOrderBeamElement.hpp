@@ -0,0 +1,56 @@
+#ifndef SFEMS_HIGHERORDERBEAMELEMENT_HPP
+#define SFEMS_HIGHERORDERBEAMELEMENT_HPP
+
+#include <vector>
+#include <Eigen/Dense>
+#include "BeamElement.hpp"
+#include "connectivity.hpp"
+
+/*
+ * A corotational beam that is second order in the element coordinates (von Karman): the axial strain u' + w'^2 / 2
+ * includes the shortening by the deflection, so the bending of an element interacts with its axial force.
+ * The linear element only feels the axial force through the rotation of its chord.
+ * The deflection w is the cubic of the end rotations, the axial displacement u is quadratic through an internal
+ * node in the middle, which lets the axial force stay constant along the element as the equilibrium demands.
+ * The element can start curved, as the cubic of initial end slopes w0', so an arch is not a polygon of chords
+ * and its buckling loads converge much faster than with the linear element.
+ * The internal node carries no load and is eliminated in every element (static condensation), so the structure
+ * still has three degrees of freedom per node.
+ */
+class HigherOrderBeamElement final : public CorotationalElement<HigherOrderBeamElement> {
+    const double axialStiffness;
+    const double bendingStiffness;
+    // The undeformed slopes of the element relative to its chord at both ends
+    const Eigen::Vector2d initialSlopes;
+    // Stiffness of (elongation, theta1, theta2) at the last calculateInnerForces, with the internal node condensed
+    Eigen::Matrix3d localMaterialStiffness;
+    // The part of the stiffness from the axial force, which only couples the end rotations
+    Eigen::Matrix3d localGeometricStiffness = Eigen::Matrix3d::Zero();
+
+public:
+    HigherOrderBeamElement(
+            const Eigen::Vector2d &firstCoordinate,
+            const Eigen::Vector2d &secondCoordinate,
+            const ElementProperties &properties,
+            unsigned int index,
+            const Eigen::Vector2d &initialSlopes = Eigen::Vector2d::Zero()
+    );
+
+    Eigen::Matrix<double, 6, 1> calculateInnerForces();
+
+    // Uses the deformation of the last calculateInnerForces
+    Eigen::Matrix<double, 6, 6> calculateMaterialStiffness() const;
+
+    Eigen::Matrix<double, 6, 6> calculateGeometricStiffness() const;
+};
+
+/*
+ * The initial end slopes of every element for a smooth curve through the nodes. At a node between two elements
+ * the curve follows the circle through the node and its neighbours, nodes at a sharper turn than 45 degrees and
+ * the nodes of more or fewer elements are corners, where an element continues its circular arc.
+ * Straight members stay straight.
+ */
+std::vector<Eigen::Vector2d> calculateInitialSlopes(const std::vector<double> &vertices,
+                                                    const std::vector<ElementNodes> &connectivity);
+
+#endif //SFEMS_HIGHERORDERBEAMELEMENT_HPP
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+#include "adaptivity.hpp"
+
+// Relative distance from the chord below which a node between two elements counts as collinear
+const double COLLINEAR_TOLERANCE = 1e-9;
+
+/*
+ * How far the middle of the arc from first to second lies to the right of the middle of their chord, on the circle
+ * through three consecutive nodes that include both. Zero for nodes on a line, exact for nodes on a circle
+ */
+double arcOffset(const Eigen::Vector2d &first, const Eigen::Vector2d &second,
+                 const Eigen::Vector2d &x0, const Eigen::Vector2d &x1, const Eigen::Vector2d &x2) {
+    const Eigen::Vector2d a = x1 - x0, b = x2 - x1;
+    // Signed curvature of the circle through the three nodes, positive when it turns left
+    const double curvature = 2 * (a(0) * b(1) - a(1) * b(0)) / (a.norm() * b.norm() * (x2 - x0).norm());
+    const double halfChord = (second - first).norm() / 2;
+    const double sine = std::min(std::abs(curvature) * halfChord, 1.0);
+    return curvature * halfChord * halfChord / (1 + std::sqrt(1 - sine * sine));
+}
+
+std::vector<double> calculateRefinementIndicators(const std::vector<ElementNodes> &connectivity,
+                                                  const Eigen::VectorXd &displacement,
+                                                  const std::vector<Eigen::Matrix<double, 6, 1>> &innerForces,
+                                                  const AdaptivitySettings &settings) {
+    double largestMoment = 0;
+    for (const auto &forces : innerForces) {
+        largestMoment = std::max({largestMoment, std::abs(forces(2)), std::abs(forces(5))});
+    }
+    std::vector<double> indicators(connectivity.size());
+    for (size_t e = 0; e < connectivity.size(); ++e) {
+        const auto &nodes = connectivity[e];
+        // The rigid rotation of the element cancels, what is left is its curvature integrated over its length
+        const double rotationChange = std::abs(displacement(3 * nodes.second + 2) - displacement(3 * nodes.first + 2));
+        indicators[e] = rotationChange / settings.rotationTolerance;
+        // The end moments act against each other, so their sum is the change of the bending moment, V * L
+        const double momentChange = std::abs(innerForces[e](2) + innerForces[e](5));
+        if (largestMoment > 0)
+            indicators[e] = std::max(indicators[e], momentChange / (largestMoment * settings.momentTolerance));
+    }
+    return indicators;
+}
+
+AdaptedMesh adaptMesh(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                      const std::vector<double> &indicators, const std::vector<bool> &pinned,
+                      const AdaptivitySettings &settings) {
+    const size_t nodeCount = vertices.size() / 2;
+    const size_t elementCount = connectivity.size();
+    auto vertex = [&vertices](unsigned int node) {
+        return Eigen::Vector2d{vertices[2 * node], vertices[2 * node + 1]};
+    };
+    auto length = [&](const ElementNodes &nodes) { return (vertex(nodes.second) - vertex(nodes.first)).norm(); };
+
+    std::vector<std::vector<unsigned int>> nodeElements(nodeCount);
+    for (unsigned int e = 0; e < elementCount; ++e) {
+        nodeElements[connectivity[e].first].push_back(e);
+        nodeElements[connectivity[e].second].push_back(e);
+    }
+
+    AdaptedMesh mesh;
+    std::vector<bool> split(elementCount, false);
+    size_t newElementCount = elementCount;
+    for (size_t e = 0; e < elementCount && newElementCount < settings.maxElements; ++e) {
+        if (indicators[e] <= 1 || length(connectivity[e]) / 2 < settings.minElementLength) continue;
+        split[e] = true;
+        ++newElementCount;
+        ++mesh.splitCount;
+    }
+
+    // A merged pair continues as its first element with the removed node replaced by the far end of the second
+    std::vector<ElementNodes> merged = connectivity;
+    std::vector<bool> used = split;
+    std::vector<bool> dropped(elementCount, false);
+    std::vector<bool> removed(nodeCount, false);
+    for (unsigned int node = 0; node < nodeCount; ++node) {
+        if (pinned[node] || nodeElements[node].size() != 2) continue;
+        const auto first = nodeElements[node][0], second = nodeElements[node][1];
+        if (used[first] || used[second]) continue;
+        if (std::max(indicators[first], indicators[second]) >= settings.coarseningFraction) continue;
+        const auto &secondNodes = connectivity[second];
+        const unsigned int farEnd = secondNodes.first == node ? secondNodes.second : secondNodes.first;
+        ElementNodes nodes = connectivity[first];
+        (nodes.first == node ? nodes.first : nodes.second) = farEnd;
+        if (nodes.first == nodes.second) continue;
+        const double mergedLength = length(nodes);
+        if (mergedLength > settings.maxElementLength) continue;
+        const Eigen::Vector2d chord = (vertex(nodes.second) - vertex(nodes.first)) / mergedLength;
+        const Eigen::Vector2d offset = vertex(node) - vertex(nodes.first);
+        if (std::abs(chord(0) * offset(1) - chord(1) * offset(0)) > COLLINEAR_TOLERANCE * mergedLength) continue;
+        merged[first] = nodes;
+        dropped[second] = true;
+        used[first] = used[second] = true;
+        removed[node] = true;
+        ++mesh.mergeCount;
+    }
+
+    // The far end of the other element at a node between exactly two elements, -1 elsewhere
+    auto neighbour = [&](unsigned int node, unsigned int element) {
+        if (nodeElements[node].size() != 2) return -1;
+        const auto &other = connectivity[nodeElements[node][nodeElements[node][0] == element ? 1 : 0]];
+        return static_cast<int>(other.first == node ? other.second : other.first);
+    };
+    // The middle of a split element is put on the curve through its neighbours, so a refined arch gets rounder
+    auto splitPoint = [&](unsigned int e) {
+        const Eigen::Vector2d first = vertex(connectivity[e].first), second = vertex(connectivity[e].second);
+        const int before = neighbour(connectivity[e].first, e), after = neighbour(connectivity[e].second, e);
+        double offset = 0;
+        if (before >= 0) offset += arcOffset(first, second, vertex(before), first, second);
+        if (after >= 0) offset += arcOffset(first, second, first, second, vertex(after));
+        if (before >= 0 && after >= 0) offset /= 2;
+        const Eigen::Vector2d chord = (second - first).normalized();
+        return Eigen::Vector2d((first + second) / 2 + offset * Eigen::Vector2d{chord(1), -chord(0)});
+    };
+
+    // The middle of a split element follows the first node of the element, which keeps chains numbered along
+    mesh.newNodes.assign(nodeCount, -1);
+    std::vector<int> middleNodes(elementCount, -1);
+    for (unsigned int node = 0; node < nodeCount; ++node) {
+        if (removed[node]) continue;
+        mesh.newNodes[node] = static_cast<int>(mesh.oldNodes.size());
+        mesh.oldNodes.push_back(static_cast<int>(node));
+        mesh.splitElements.push_back(-1);
+        mesh.vertices.push_back(vertices[2 * node]);
+        mesh.vertices.push_back(vertices[2 * node + 1]);
+        for (auto e : nodeElements[node]) {
+            if (!split[e] || connectivity[e].first != node) continue;
+            const Eigen::Vector2d middle = splitPoint(e);
+            middleNodes[e] = static_cast<int>(mesh.oldNodes.size());
+            mesh.oldNodes.push_back(-1);
+            mesh.splitElements.push_back(static_cast<int>(e));
+            mesh.vertices.push_back(middle(0));
+            mesh.vertices.push_back(middle(1));
+        }
+    }
+
+    mesh.connectivity.reserve(newElementCount);
+    for (size_t e = 0; e < elementCount; ++e) {
+        if (dropped[e]) continue;
+        const auto first = static_cast<unsigned int>(mesh.newNodes[merged[e].first]);
+        const auto second = static_cast<unsigned int>(mesh.newNodes[merged[e].second]);
+        if (split[e]) {
+            const auto middle = static_cast<unsigned int>(middleNodes[e]);
+            mesh.connectivity.push_back(ElementNodes{first, middle});
+            mesh.connectivity.push_back(ElementNodes{middle, second});
+        } else {
+            mesh.connectivity.push_back(ElementNodes{first, second});
+        }
+    }
+    return mesh;
+}
+
+/*
+ * The displacement of a point at xi in [0, 1] along an element, from its corotational deformed shape.
+ * point: the undeformed point, its distance from the chord is carried along with the rotation of the chord
+ */
+Eigen::Vector3d interpolateCorotational(const Eigen::Vector2d &first, const Eigen::Vector2d &second,
+                                        const Eigen::Vector3d &firstDisplacement,
+                                        const Eigen::Vector3d &secondDisplacement,
+                                        const Eigen::Vector2d &point, double xi) {
+    const Eigen::Vector2d beamVector = second - first;
+    const Eigen::Vector2d beamUnitVector = beamVector.normalized();
+    const Eigen::Vector2d beamUnitNormal{-beamUnitVector(1), beamUnitVector(0)};
+    const double chordDistance = (point - first - xi * beamVector).dot(beamUnitNormal);
+    const Eigen::Vector2d deformedBeamVector = beamVector + (secondDisplacement - firstDisplacement).head<2>();
+    const double deformedLength = deformedBeamVector.norm();
+    const Eigen::Vector2d tangent = deformedBeamVector / deformedLength;
+    const Eigen::Vector2d normal{-tangent(1), tangent(0)};
+    // The end rotations relative to the chord, as in BeamElement::calculateInnerForces
+    auto chordRotation = [&](double nodeAngle) {
+        const Eigen::Vector2d nodeVector = Eigen::Rotation2Dd(nodeAngle) * beamUnitVector;
+        return std::asin(nodeVector.dot(normal));
+    };
+    const double theta1 = chordRotation(firstDisplacement(2));
+    const double theta2 = chordRotation(secondDisplacement(2));
+
+    // Cubic Hermite deflection that vanishes at both ends and has the slopes theta1 and theta2 there
+    const double deflection = deformedLength * (theta1 * xi * (1 - xi) * (1 - xi) - theta2 * xi * xi * (1 - xi));
+    const double slope = theta1 * (1 - xi) * (1 - 3 * xi) + theta2 * xi * (3 * xi - 2);
+    const Eigen::Vector2d position = first + firstDisplacement.head<2>() + xi * deformedLength * tangent +
+                                     (deflection + chordDistance) * normal;
+    Eigen::Vector3d displacement;
+    displacement << position - point, firstDisplacement(2) - theta1 + std::atan(slope);
+    return displacement;
+}
+
+Eigen::VectorXd transferDisplacement(const AdaptedMesh &mesh, const std::vector<double> &vertices,
+                                     const std::vector<ElementNodes> &connectivity,
+                                     const Eigen::VectorXd &displacement) {
+    Eigen::VectorXd transferred(3 * mesh.oldNodes.size());
+    for (size_t node = 0; node < mesh.oldNodes.size(); ++node) {
+        if (mesh.oldNodes[node] >= 0) {
+            transferred.segment<3>(3 * node) = displacement.segment<3>(3 * mesh.oldNodes[node]);
+            continue;
+        }
+        const auto &nodes = connectivity[mesh.splitElements[node]];
+        transferred.segment<3>(3 * node) = interpolateCorotational(
+                Eigen::Vector2d{vertices[2 * nodes.first], vertices[2 * nodes.first + 1]},
+                Eigen::Vector2d{vertices[2 * nodes.second], vertices[2 * nodes.second + 1]},
+                displacement.segment<3>(3 * nodes.first), displacement.segment<3>(3 * nodes.second),
+                Eigen::Vector2d{mesh.vertices[2 * node], mesh.vertices[2 * node + 1]}, 0.5);
+    }
+    return transferred;
+}
@@ -0,0 +1,72 @@
+#ifndef SFEMS_ADAPTIVITY_HPP
+#define SFEMS_ADAPTIVITY_HPP
+
+#include <vector>
+#include <Eigen/Dense>
+#include "connectivity.hpp"
+
+/*
+ * Settings of the h-adaptive mesh, see Structure::adapt
+ * interval: increments between adaptations, 0 disables them
+ * rotationTolerance: largest change of the rotation over an element, in radians
+ * momentTolerance: largest change of the bending moment over an element, relative to the largest bending moment
+ * coarseningFraction: neighbours are merged where both stay below this fraction of the tolerances
+ * minElementLength, maxElementLength: limits of the undeformed element length
+ * maxElements: no element is split once the mesh has this many
+ */
+struct AdaptivitySettings {
+    unsigned int interval = 0;
+    double rotationTolerance;
+    double momentTolerance;
+    double coarseningFraction;
+    double minElementLength;
+    double maxElementLength;
+    unsigned int maxElements;
+};
+
+/*
+ * A mesh derived from another one by splitting elements at their middle and merging pairs of elements.
+ * The middle of a split element is put on the circle through its neighbouring nodes, so arches stay round and
+ * straight members straight. Only a node between two collinear elements is removed.
+ * oldNodes: for every new node the node of the old mesh it was, -1 for the middle of a split element
+ * splitElements: for every new node the old element it is the middle of, -1 for the nodes of the old mesh
+ * newNodes: for every old node its index in the new mesh, -1 if it was removed
+ */
+struct AdaptedMesh {
+    std::vector<double> vertices;
+    std::vector<ElementNodes> connectivity;
+    std::vector<int> oldNodes;
+    std::vector<int> splitElements;
+    std::vector<int> newNodes;
+    unsigned int splitCount = 0;
+    unsigned int mergeCount = 0;
+};
+
+/*
+ * The refinement indicator of every element from its change of rotation and bending moment,
+ * 1 is the tolerance and elements above it are split
+ * innerForces: the local inner forces of every element, as BeamElement::getLocalInnerForces
+ */
+std::vector<double> calculateRefinementIndicators(const std::vector<ElementNodes> &connectivity,
+                                                  const Eigen::VectorXd &displacement,
+                                                  const std::vector<Eigen::Matrix<double, 6, 1>> &innerForces,
+                                                  const AdaptivitySettings &settings);
+
+/*
+ * Splits the elements with an indicator above 1 and merges neighbours below the coarsening fraction.
+ * pinned: nodes that are kept, e.g. those with loads or boundary conditions
+ */
+AdaptedMesh adaptMesh(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                      const std::vector<double> &indicators, const std::vector<bool> &pinned,
+                      const AdaptivitySettings &settings);
+
+/*
+ * Transfers a displacement onto the adapted mesh. The nodes of the old mesh keep theirs, the middle of a split
+ * element is placed on its corotational deformed shape: stretched evenly along the deformed chord and deflected
+ * by the cubic of the end rotations relative to the chord, so large rotations carry over exactly.
+ */
+Eigen::VectorXd transferDisplacement(const AdaptedMesh &mesh, const std::vector<double> &vertices,
+                                     const std::vector<ElementNodes> &connectivity,
+                                     const Eigen::VectorXd &displacement);
+
+#endif //SFEMS_ADAPTIVITY_HPP
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "blockTridiagonalSolver.hpp"
+
+// Pivots this much smaller than the diagonal of the tangent count as vanished
+const double PIVOT_TOLERANCE = 1e-14;
+// Shorter segments do not pay off the separator they add
+const size_t MIN_SEGMENT_BLOCKS = 64;
+
+bool BlockTridiagonalSolver::BlockChain::decompose(const Eigen::Matrix3d *diagonal,
+                                                   const Eigen::Matrix3d *subDiagonal, size_t count) {
+    pivots.resize(count);
+    couplings.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        Eigen::Matrix3d schur = diagonal[i];
+        if (i > 0) {
+            couplings[i] = pivots[i - 1].solve(subDiagonal[i].transpose());
+            schur.noalias() -= subDiagonal[i] * couplings[i];
+        }
+        pivots[i].compute(schur);
+        const auto &pivotValues = pivots[i].vectorD();
+        if (pivots[i].info() != Eigen::Success || !pivotValues.allFinite() ||
+            pivotValues.cwiseAbs().minCoeff() <= PIVOT_TOLERANCE * diagonal[i].diagonal().cwiseAbs().maxCoeff()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BlockTridiagonalSolver::BlockChain::solve(Eigen::Ref<Eigen::MatrixXd> x, size_t firstBlock) const {
+    const auto count = pivots.size();
+    // With S_i^-1 A(i, i - 1) = couplings[i]^T by symmetry
+    for (size_t i = firstBlock + 1; i < count; ++i) {
+        x.middleRows<3>(3 * i).noalias() -= couplings[i].transpose() * x.middleRows<3>(3 * (i - 1));
+    }
+    for (size_t i = firstBlock; i < count; ++i) x.middleRows<3>(3 * i) = pivots[i].solve(x.middleRows<3>(3 * i));
+    for (size_t i = count; i-- > 1;) {
+        x.middleRows<3>(3 * (i - 1)).noalias() -= couplings[i] * x.middleRows<3>(3 * i);
+    }
+}
+
+int BlockTridiagonalSolver::BlockChain::negativePivots() const {
+    int count = 0;
+    for (const auto &pivot : pivots) count += static_cast<int>((pivot.vectorD().array() < 0).count());
+    return count;
+}
+
+/*
+ * Sorts the elements into the blocks of their rows and splits the chain into segments.
+ * Throws if an element couples nodes that are not next to each other in the elimination order
+ */
+void BlockTridiagonalSolver::findBlocks(const Tangent &newTangent) {
+    if (newTangent.size() % 3 != 0) throw std::runtime_error("The block tridiagonal solver needs 3 dofs per node");
+    const auto blockCount = static_cast<size_t>(newTangent.size() / 3);
+    diagonal.resize(blockCount);
+    subDiagonal.resize(blockCount);
+    spikes.resize(blockCount);
+    ordered.resize(static_cast<Eigen::Index>(3 * blockCount));
+    constrainedPosition.assign(3 * blockCount, false);
+    for (size_t i = 0; i < 3 * blockCount; ++i) {
+        if (newTangent.isConstrained(i)) constrainedPosition[newTangent.position(i)] = true;
+    }
+
+    blockElementStart.assign(blockCount + 1, 0);
+    for (size_t element = 0; element < newTangent.elementCount(); ++element) {
+        const auto &map = newTangent.elementMap(element);
+        const auto first = newTangent.position(map[0]) / 3, second = newTangent.position(map[3]) / 3;
+        if (std::max(first, second) - std::min(first, second) > 1) {
+            throw std::runtime_error("The block tridiagonal solver needs a chain, element " +
+                                     std::to_string(element) + " couples nodes that are not neighbours");
+        }
+        ++blockElementStart[first + 1];
+        if (second != first) ++blockElementStart[second + 1];
+    }
+    for (size_t i = 0; i < blockCount; ++i) blockElementStart[i + 1] += blockElementStart[i];
+    blockElements.resize(blockElementStart.back());
+    std::vector<size_t> nextSlot(blockElementStart.begin(), blockElementStart.end() - 1);
+    for (size_t element = 0; element < newTangent.elementCount(); ++element) {
+        const auto &map = newTangent.elementMap(element);
+        const auto first = newTangent.position(map[0]) / 3, second = newTangent.position(map[3]) / 3;
+        blockElements[nextSlot[first]++] = static_cast<unsigned int>(element);
+        if (second != first) blockElements[nextSlot[second]++] = static_cast<unsigned int>(element);
+    }
+
+    size_t count = requestedSegments;
+#ifdef _OPENMP
+    if (count == 0) count = static_cast<size_t>(omp_get_max_threads());
+#endif
+    count = std::max<size_t>(1, std::min(count, blockCount / MIN_SEGMENT_BLOCKS));
+    segments.resize(count);
+    segmentStart.resize(count + 1);
+    for (size_t segment = 0; segment <= count; ++segment) segmentStart[segment] = segment * blockCount / count;
+    reduced.resize(static_cast<Eigen::Index>(3 * (count - 1)));
+}
+
+/*
+ * Every block row gathers from its own elements, so the rows are assembled in parallel
+ */
+void BlockTridiagonalSolver::assemble(const Tangent &newTangent) {
+    const auto blockCount = static_cast<long>(diagonal.size());
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < blockCount; ++i) {
+        diagonal[i].setZero();
+        subDiagonal[i].setZero();
+        for (auto slot = blockElementStart[i]; slot < blockElementStart[i + 1]; ++slot) {
+            const auto element = blockElements[slot];
+            const auto &map = newTangent.elementMap(element);
+            const auto &stiffness = newTangent.elementStiffness(element);
+            for (int row = 0; row < 6; ++row) {
+                const auto rowPosition = newTangent.position(map[row]);
+                if (static_cast<long>(rowPosition / 3) != i || newTangent.isConstrained(map[row])) continue;
+                for (int column = 0; column < 6; ++column) {
+                    if (newTangent.isConstrained(map[column])) continue;
+                    const auto columnPosition = newTangent.position(map[column]);
+                    if (columnPosition / 3 == rowPosition / 3) {
+                        diagonal[i](rowPosition % 3, columnPosition % 3) += stiffness(row, column);
+                    } else if (columnPosition / 3 + 1 == rowPosition / 3) {
+                        subDiagonal[i](rowPosition % 3, columnPosition % 3) += stiffness(row, column);
+                    }
+                }
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            if (constrainedPosition[3 * i + k]) diagonal[i](k, k) = 1;
+        }
+    }
+}
+
+/*
+ * Decomposes the segments in parallel, then the separators with what the segments leave of them
+ * (the Schur complement). Returns false if a pivot vanished
+ */
+bool BlockTridiagonalSolver::decompose() {
+    const auto count = static_cast<long>(segmentCount());
+    bool decomposed = true;
+#pragma omp parallel for schedule(static) reduction(&&:decomposed)
+    for (long segment = 0; segment < count; ++segment) {
+        const auto first = segmentStart[segment], end = segmentEnd(segment);
+        if (!segments[segment].decompose(&diagonal[first], &subDiagonal[first], end - first)) {
+            decomposed = false;
+            continue;
+        }
+        if (count == 1) continue;
+        // The inverse of the segment times its coupling A(first, first - 1) and A(end - 1, end) to the separators
+        Eigen::MatrixXd spike = Eigen::MatrixXd::Zero(static_cast<Eigen::Index>(3 * (end - first)), 6);
+        if (segment > 0) {
+            spike.topLeftCorner<3, 3>() = subDiagonal[first];
+            segments[segment].solve(spike.leftCols<3>());
+        }
+        if (segment + 1 < count) {
+            spike.bottomRightCorner<3, 3>() = subDiagonal[end].transpose();
+            segments[segment].solve(spike.rightCols<3>(), end - first - 1);
+        }
+        for (size_t i = first; i < end; ++i) spikes[i] = spike.middleRows<3>(static_cast<Eigen::Index>(3 * (i - first)));
+    }
+    if (!decomposed) return false;
+
+    std::vector<Eigen::Matrix3d> separatorDiagonal(count - 1), separatorSubDiagonal(count - 1);
+    for (long j = 0; j + 1 < count; ++j) {
+        const auto separator = segmentStart[j + 1] - 1;
+        separatorDiagonal[j] = diagonal[separator] -
+                               subDiagonal[separator] * spikes[separator - 1].rightCols<3>() -
+                               subDiagonal[separator + 1].transpose() * spikes[separator + 1].leftCols<3>();
+        if (j > 0) separatorSubDiagonal[j] = -subDiagonal[separator] * spikes[separator - 1].leftCols<3>();
+    }
+    return separators.decompose(separatorDiagonal.data(), separatorSubDiagonal.data(), count - 1);
+}
+
+void BlockTridiagonalSolver::factorize(const Tangent &newTangent) {
+    if (&newTangent != tangent || 3 * diagonal.size() != newTangent.size()) findBlocks(newTangent);
+    tangent = &newTangent;
+    assemble(newTangent);
+    useFallback = !decompose();
+    if (useFallback) fallback.factorize(newTangent);
+}
+
+Eigen::VectorXd BlockTridiagonalSolver::solve(const Eigen::VectorXd &b) {
+    if (useFallback) return fallback.solve(b);
+    const auto size = ordered.size();
+#pragma omp parallel for schedule(static)
+    for (Eigen::Index i = 0; i < size; ++i) ordered(tangent->position(i)) = b(i);
+
+    // The segments as if the separators were fixed
+    const auto count = static_cast<long>(segmentCount());
+#pragma omp parallel for schedule(static)
+    for (long segment = 0; segment < count; ++segment) {
+        const auto first = segmentStart[segment], end = segmentEnd(segment);
+        segments[segment].solve(ordered.segment(static_cast<Eigen::Index>(3 * first),
+                                                static_cast<Eigen::Index>(3 * (end - first))));
+    }
+    // The separators, with the solutions of the segments moved to the right hand side
+    for (long j = 0; j + 1 < count; ++j) {
+        const auto separator = static_cast<Eigen::Index>(segmentStart[j + 1] - 1);
+        reduced.segment<3>(3 * j) = ordered.segment<3>(3 * separator) -
+                                    subDiagonal[separator] * ordered.segment<3>(3 * (separator - 1)) -
+                                    subDiagonal[separator + 1].transpose() * ordered.segment<3>(3 * (separator + 1));
+    }
+    separators.solve(reduced);
+    for (long j = 0; j + 1 < count; ++j) {
+        ordered.segment<3>(static_cast<Eigen::Index>(3 * (segmentStart[j + 1] - 1))) = reduced.segment<3>(3 * j);
+    }
+    // And the segments corrected by the displacement of their separators
+#pragma omp parallel for schedule(static)
+    for (long segment = 0; segment < count; ++segment) {
+        for (size_t i = segmentStart[segment]; i < segmentEnd(segment); ++i) {
+            auto x = ordered.segment<3>(static_cast<Eigen::Index>(3 * i));
+            if (segment > 0) x.noalias() -= spikes[i].leftCols<3>() * reduced.segment<3>(3 * (segment - 1));
+            if (segment + 1 < count) x.noalias() -= spikes[i].rightCols<3>() * reduced.segment<3>(3 * segment);
+        }
+    }
+
+    Eigen::VectorXd x(size);
+#pragma omp parallel for schedule(static)
+    for (Eigen::Index i = 0; i < size; ++i) x(i) = ordered(tangent->position(i));
+    return x;
+}
+
+int BlockTridiagonalSolver::negativePivots() const {
+    if (useFallback) return fallback.negativePivots();
+    int count = separators.negativePivots();
+    for (const auto &segment : segments) count += segment.negativePivots();
+    return count;
+}
@@ -0,0 +1,83 @@
+#ifndef SFEMS_BLOCKTRIDIAGONALSOLVER_HPP
+#define SFEMS_BLOCKTRIDIAGONALSOLVER_HPP
+
+#include <vector>
+#include <Eigen/Dense>
+#include "linearSolver.hpp"
+
+/*
+ * Solves the tangent of a chain of elements such as an arch, where every node is only coupled to the nodes
+ * before and after it in the elimination order, so the tangent is block tridiagonal with 3x3 blocks.
+ * The chain is split into segments with a separator node between each two of them (partition method as in SPIKE).
+ * The segments are eliminated independently on the OpenMP threads, which leaves a block tridiagonal system
+ * of the separators with one block per segment that is solved serially.
+ * With one segment this is the block Thomas algorithm.
+ * Falls back to the SparseDirectSolver when a pivot vanishes, and throws if the tangent is not a chain.
+ */
+class BlockTridiagonalSolver : public LinearSolver {
+    /*
+     * Block LDL^T decomposition of a symmetric block tridiagonal matrix, pivoting only inside the blocks
+     */
+    struct BlockChain {
+        // S_i = A(i, i) - A(i, i - 1) S_(i - 1)^-1 A(i - 1, i)
+        std::vector<Eigen::LDLT<Eigen::Matrix3d>> pivots;
+        // S_(i - 1)^-1 A(i - 1, i)
+        std::vector<Eigen::Matrix3d> couplings;
+
+        // subDiagonal[i] is A(i, i - 1), the first one is not used. Returns false if a pivot vanished
+        bool decompose(const Eigen::Matrix3d *diagonal, const Eigen::Matrix3d *subDiagonal, size_t count);
+
+        // Solves in place for every column of x, which has three rows per block and is zero before firstBlock
+        void solve(Eigen::Ref<Eigen::MatrixXd> x, size_t firstBlock = 0) const;
+
+        int negativePivots() const;
+    };
+
+    // Segments to split the chain into, 0 for one per OpenMP thread
+    const unsigned int requestedSegments;
+
+    // The tangent in blocks of the elimination order, subDiagonal[i] is A(i, i - 1)
+    std::vector<Eigen::Matrix3d> diagonal, subDiagonal;
+    // The elements with a row in block i are blockElements[blockElementStart[i]] until blockElementStart[i + 1]
+    std::vector<size_t> blockElementStart;
+    std::vector<unsigned int> blockElements;
+    // Positions of the constrained degrees of freedom, with 1 on the diagonal
+    std::vector<bool> constrainedPosition;
+
+    // First block of every segment, the last block of every segment but the last is its separator
+    std::vector<size_t> segmentStart;
+    std::vector<BlockChain> segments;
+    BlockChain separators;
+    // The inverse of its segment times the coupling to the separators before and after it, for every block
+    std::vector<Eigen::Matrix<double, 3, 6>> spikes;
+    // Work vectors of the solves
+    Eigen::VectorXd ordered, reduced;
+
+    const Tangent *tangent = nullptr;
+    bool useFallback = false;
+    SparseDirectSolver fallback;
+
+    void findBlocks(const Tangent &tangent);
+
+    void assemble(const Tangent &tangent);
+
+    bool decompose();
+
+    size_t segmentCount() const { return segments.size(); }
+
+    // Blocks of a segment without its separator
+    size_t segmentEnd(size_t segment) const {
+        return segment + 1 < segmentCount() ? segmentStart[segment + 1] - 1 : diagonal.size();
+    }
+
+public:
+    explicit BlockTridiagonalSolver(unsigned int segments = 0) : requestedSegments(segments) {}
+
+    void factorize(const Tangent &tangent) override;
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b) override;
+
+    int negativePivots() const override;
+};
+
+#endif //SFEMS_BLOCKTRIDIAGONALSOLVER_HPP
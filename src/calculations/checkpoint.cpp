@@ -0,0 +1,60 @@
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include "checkpoint.hpp"
+
+void writeCheckpoint(const std::string &filename, const StructureState &state, const LoggerPositions &positions) {
+    CheckpointHeader header{};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.firstIteration = state.firstIteration;
+    header.degreesOfFreedom = static_cast<uint64_t>(state.displacement.size());
+    header.increment = state.increment;
+    header.loadingParameter = state.loadingParameter;
+    header.negativePivots = state.negativePivots;
+    header.loggerPositions = positions;
+
+    // Write to a temporary file first so a crash while writing never destroys the last checkpoint
+    const auto temporaryFilename = filename + ".tmp";
+    {
+        std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(state.displacement.data()),
+                   sizeof(double) * state.displacement.size());
+        file.write(reinterpret_cast<const char *>(state.elementDisplacement.data()),
+                   sizeof(double) * state.elementDisplacement.size());
+        file.write(reinterpret_cast<const char *>(state.previousElementDisplacement.data()),
+                   sizeof(double) * state.previousElementDisplacement.size());
+        file.write(reinterpret_cast<const char *>(state.lastDeltaDisplacement.data()),
+                   sizeof(double) * state.lastDeltaDisplacement.size());
+        if (!file) throw std::runtime_error("Could not write checkpoint " + temporaryFilename);
+    }
+    std::rename(temporaryFilename.c_str(), filename.c_str());
+}
+
+void readCheckpoint(const std::string &filename, StructureState &state, LoggerPositions &positions) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) throw std::runtime_error("Could not open checkpoint " + filename);
+    CheckpointHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CHECKPOINT_VERSION)
+        throw std::runtime_error(filename + " is not a supported checkpoint file");
+
+    const auto degreesOfFreedom = static_cast<Eigen::Index>(header.degreesOfFreedom);
+    state.displacement.resize(degreesOfFreedom);
+    state.elementDisplacement.resize(degreesOfFreedom);
+    state.previousElementDisplacement.resize(degreesOfFreedom);
+    state.lastDeltaDisplacement.resize(degreesOfFreedom);
+    file.read(reinterpret_cast<char *>(state.displacement.data()), sizeof(double) * degreesOfFreedom);
+    file.read(reinterpret_cast<char *>(state.elementDisplacement.data()), sizeof(double) * degreesOfFreedom);
+    file.read(reinterpret_cast<char *>(state.previousElementDisplacement.data()), sizeof(double) * degreesOfFreedom);
+    file.read(reinterpret_cast<char *>(state.lastDeltaDisplacement.data()), sizeof(double) * degreesOfFreedom);
+    if (!file) throw std::runtime_error("Checkpoint " + filename + " is incomplete");
+    state.loadingParameter = header.loadingParameter;
+    state.firstIteration = header.firstIteration != 0;
+    state.increment = static_cast<unsigned int>(header.increment);
+    state.negativePivots = header.negativePivots;
+    positions = header.loggerPositions;
+}
@@ -0,0 +1,52 @@
+#ifndef SFEMS_CHECKPOINT_HPP
+#define SFEMS_CHECKPOINT_HPP
+
+#include <cstdint>
+#include <string>
+#include <Eigen/Dense>
+#include "logger.hpp"
+
+/*
+ * Everything needed to continue a calculation from a converged point.
+ * The element states are stored as the displacements of the last two element updates,
+ * since the tangent stiffness uses the inner forces from the update before the last one.
+ */
+struct StructureState {
+    Eigen::VectorXd displacement;
+    Eigen::VectorXd elementDisplacement;
+    Eigen::VectorXd previousElementDisplacement;
+    Eigen::VectorXd lastDeltaDisplacement;
+    double loadingParameter;
+    bool firstIteration;
+    unsigned int increment;
+    int negativePivots;
+};
+
+/*
+ * Binary checkpoint file, laid out as (native byte order):
+ *   CheckpointHeader
+ *   double displacement[header.degreesOfFreedom]
+ *   double elementDisplacement[header.degreesOfFreedom]
+ *   double previousElementDisplacement[header.degreesOfFreedom]
+ *   double lastDeltaDisplacement[header.degreesOfFreedom]
+ */
+const char CHECKPOINT_MAGIC[8] = {'S', 'F', 'E', 'M', 'S', 'C', 'H', 'K'};
+const uint32_t CHECKPOINT_VERSION = 4;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t firstIteration;
+    uint64_t degreesOfFreedom;
+    uint64_t increment;
+    double loadingParameter;
+    int32_t negativePivots;
+    uint32_t reserved;
+    LoggerPositions loggerPositions;
+};
+
+void writeCheckpoint(const std::string &filename, const StructureState &state, const LoggerPositions &positions);
+
+void readCheckpoint(const std::string &filename, StructureState &state, LoggerPositions &positions);
+
+#endif //SFEMS_CHECKPOINT_HPP
@@ -0,0 +1,33 @@
+#include <stdexcept>
+#include <string>
+#include "connectivity.hpp"
+
+std::vector<ElementNodes> chainConnectivity(size_t nodeCount) {
+    std::vector<ElementNodes> connectivity;
+    for (unsigned int node = 0; node + 1 < nodeCount; ++node) {
+        connectivity.push_back(ElementNodes{node, node + 1});
+    }
+    return connectivity;
+}
+
+void validateConnectivity(const std::vector<ElementNodes> &connectivity, size_t nodeCount) {
+    for (size_t element = 0; element < connectivity.size(); ++element) {
+        const auto &nodes = connectivity[element];
+        if (nodes.first >= nodeCount || nodes.second >= nodeCount)
+            throw std::runtime_error("Element " + std::to_string(element) + " refers to a node that does not exist");
+        if (nodes.first == nodes.second)
+            throw std::runtime_error("Element " + std::to_string(element) + " connects a node with itself");
+    }
+}
+
+std::vector<ElementDegreesOfFreedom> mapDegreesOfFreedom(const std::vector<ElementNodes> &connectivity) {
+    std::vector<ElementDegreesOfFreedom> map;
+    map.reserve(connectivity.size());
+    for (const auto &nodes : connectivity) {
+        map.push_back(ElementDegreesOfFreedom{
+                3 * nodes.first, 3 * nodes.first + 1, 3 * nodes.first + 2,
+                3 * nodes.second, 3 * nodes.second + 1, 3 * nodes.second + 2
+        });
+    }
+    return map;
+}
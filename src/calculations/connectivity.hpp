@@ -0,0 +1,40 @@
+#ifndef SFEMS_CONNECTIVITY_HPP
+#define SFEMS_CONNECTIVITY_HPP
+
+#include <array>
+#include <vector>
+#include <Eigen/Dense>
+
+/*
+ * The two nodes an element connects, as indices into the vertices of the structure.
+ * Any frame can be described this way: open chains, closed rings and branching members.
+ */
+struct ElementNodes {
+    unsigned int first;
+    unsigned int second;
+};
+
+// The global degrees of freedom of the six element degrees of freedom, first those of the first node
+typedef std::array<unsigned int, 6> ElementDegreesOfFreedom;
+
+// Connects every node with the next one, the open chain of an arch or a beam
+std::vector<ElementNodes> chainConnectivity(size_t nodeCount);
+
+// Throws if an element refers to a node that does not exist or connects a node with itself
+void validateConnectivity(const std::vector<ElementNodes> &connectivity, size_t nodeCount);
+
+// Every node has three degrees of freedom (x, y, rotation), numbered by node
+std::vector<ElementDegreesOfFreedom> mapDegreesOfFreedom(const std::vector<ElementNodes> &connectivity);
+
+inline Eigen::Matrix<double, 6, 1> gatherElement(const Eigen::VectorXd &x, const ElementDegreesOfFreedom &map) {
+    Eigen::Matrix<double, 6, 1> values;
+    for (int i = 0; i < 6; ++i) values(i) = x(map[i]);
+    return values;
+}
+
+inline void scatterElement(Eigen::VectorXd &y, const ElementDegreesOfFreedom &map,
+                           const Eigen::Matrix<double, 6, 1> &values) {
+    for (int i = 0; i < 6; ++i) y(map[i]) += values(i);
+}
+
+#endif //SFEMS_CONNECTIVITY_HPP
@@ -0,0 +1,140 @@
+#include <cmath>
+#include <stdexcept>
+#include <Eigen/Eigenvalues>
+#include "elementArrays.hpp"
+
+// Below this amount of elements a step is too short for the threads to pay off
+const size_t PARALLEL_ELEMENT_COUNT = 4096;
+
+ElementArrays::ElementArrays(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                             const ElementProperties &properties,
+                             const Eigen::VectorXd &nominalGlobalLoad, const Eigen::VectorXd &nominalLocalLoad,
+                             const std::vector<bool> &constrained) :
+        elementCount(connectivity.size()),
+        degreesOfFreedom(constrained.size()),
+        globalLoad(nominalGlobalLoad),
+        freeDegreesOfFreedom(Eigen::VectorXd::Ones(constrained.size())),
+        lumpedMass(Eigen::VectorXd::Zero(constrained.size())) {
+    if (properties.type != ElementType::LINEAR)
+        throw std::runtime_error("Explicit dynamics and dynamic relaxation only have the linear element");
+    for (auto *array : {&beamX, &beamY, &beamLength, &unitX, &unitY, &axialStiffness, &bendingStiffness}) {
+        array->resize(elementCount);
+    }
+    firstOffset.resize(elementCount);
+    secondOffset.resize(elementCount);
+    const auto map = mapDegreesOfFreedom(connectivity);
+
+    // Counting sort of the element ends by node
+    const size_t nodeCount = vertices.size() / 2;
+    nodeElementStart.assign(nodeCount + 1, 0);
+    for (const auto &nodes : connectivity) {
+        ++nodeElementStart[nodes.first + 1];
+        ++nodeElementStart[nodes.second + 1];
+    }
+    for (size_t node = 0; node < nodeCount; ++node) {
+        nodeElementStart[node + 1] += nodeElementStart[node];
+    }
+    nodeElements.resize(2 * elementCount);
+    std::vector<unsigned int> nextSlot(nodeElementStart.begin(), nodeElementStart.end() - 1);
+    for (unsigned int e = 0; e < elementCount; ++e) {
+        nodeElements[nextSlot[connectivity[e].first]++] = 2 * e;
+        nodeElements[nextSlot[connectivity[e].second]++] = 2 * e + 1;
+    }
+
+    for (int i = 0; i < 6; ++i) {
+        localLoad[i].resize(elementCount);
+        elementForces[i].resize(elementCount);
+    }
+    for (size_t e = 0; e < elementCount; ++e) {
+        const auto &nodes = connectivity[e];
+        const Eigen::Vector2d first{vertices[2 * nodes.first], vertices[2 * nodes.first + 1]};
+        const Eigen::Vector2d second{vertices[2 * nodes.second], vertices[2 * nodes.second + 1]};
+        firstOffset[e] = 3 * nodes.first;
+        secondOffset[e] = 3 * nodes.second;
+        BeamElement element{first, second, properties, static_cast<unsigned int>(e)};
+        const Eigen::Vector2d beamVector = second - first;
+        beamX[e] = beamVector(0);
+        beamY[e] = beamVector(1);
+        beamLength[e] = beamVector.norm();
+        unitX[e] = beamVector(0) / beamLength[e];
+        unitY[e] = beamVector(1) / beamLength[e];
+        axialStiffness[e] = properties.youngsModulus * properties.crossSectionArea / beamLength[e];
+        bendingStiffness[e] = properties.youngsModulus * properties.momentOfIntertia / beamLength[e];
+        for (int i = 0; i < 6; ++i) {
+            localLoad[i][e] = nominalLocalLoad(map[e][i]);
+        }
+
+        // Without a density only the inner forces are used, by the dynamic relaxation
+        if (properties.density == 0) continue;
+        const Eigen::Matrix<double, 6, 1> mass = element.calculateMass(MassType::LUMPED).diagonal();
+        scatterElement(lumpedMass, map[e], mass);
+        const Eigen::Matrix<double, 6, 1> inverseRoot = mass.cwiseSqrt().cwiseInverse();
+        const Eigen::Matrix<double, 6, 6> scaledStiffness =
+                inverseRoot.asDiagonal() * element.calculateMaterialStiffness() * inverseRoot.asDiagonal();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 6, 6>> eigenvalues(scaledStiffness,
+                                                                               Eigen::EigenvaluesOnly);
+        largestEigenvalue = std::max(largestEigenvalue, eigenvalues.eigenvalues().maxCoeff());
+    }
+    for (size_t i = 0; i < degreesOfFreedom; ++i) {
+        if (constrained[i]) freeDegreesOfFreedom(i) = 0;
+    }
+}
+
+void ElementArrays::calculateResidual(const Eigen::VectorXd &displacement, double loadingParameter,
+                                      Eigen::VectorXd &residual) {
+    const double *u = displacement.data();
+    const bool parallel = elementCount >= PARALLEL_ELEMENT_COUNT;
+    const auto count = static_cast<long>(elementCount);
+#pragma omp parallel for simd if(parallel)
+    for (long e = 0; e < count; ++e) {
+        const double *firstDisplacement = u + firstOffset[e];
+        const double *secondDisplacement = u + secondOffset[e];
+        const double deformedX = beamX[e] + secondDisplacement[0] - firstDisplacement[0];
+        const double deformedY = beamY[e] + secondDisplacement[1] - firstDisplacement[1];
+        const double deformedLength = std::sqrt(deformedX * deformedX + deformedY * deformedY);
+        const double tangentX = deformedX / deformedLength;
+        const double tangentY = deformedY / deformedLength;
+
+        // The rotated node vectors projected on the deformed unit normal (-tangentY, tangentX)
+        const double cos1 = std::cos(firstDisplacement[2]), sin1 = std::sin(firstDisplacement[2]);
+        const double cos2 = std::cos(secondDisplacement[2]), sin2 = std::sin(secondDisplacement[2]);
+        const double theta1 = std::asin(-(cos1 * unitX[e] - sin1 * unitY[e]) * tangentY +
+                                        (sin1 * unitX[e] + cos1 * unitY[e]) * tangentX);
+        const double theta2 = std::asin(-(cos2 * unitX[e] - sin2 * unitY[e]) * tangentY +
+                                        (sin2 * unitX[e] + cos2 * unitY[e]) * tangentX);
+
+        // Local load minus local inner forces, see BeamElement::calculateInnerForces
+        const double normal = axialStiffness[e] * (deformedLength - beamLength[e]);
+        const double shear = 6 * bendingStiffness[e] / deformedLength * (theta1 + theta2);
+        const double local0 = loadingParameter * localLoad[0][e] + normal;
+        const double local1 = loadingParameter * localLoad[1][e] - shear;
+        const double local2 = loadingParameter * localLoad[2][e] - bendingStiffness[e] * (4 * theta1 + 2 * theta2);
+        const double local3 = loadingParameter * localLoad[3][e] - normal;
+        const double local4 = loadingParameter * localLoad[4][e] + shear;
+        const double local5 = loadingParameter * localLoad[5][e] - bendingStiffness[e] * (2 * theta1 + 4 * theta2);
+
+        elementForces[0][e] = tangentX * local0 - tangentY * local1;
+        elementForces[1][e] = tangentY * local0 + tangentX * local1;
+        elementForces[2][e] = local2;
+        elementForces[3][e] = tangentX * local3 - tangentY * local4;
+        elementForces[4][e] = tangentY * local3 + tangentX * local4;
+        elementForces[5][e] = local5;
+    }
+    // Every node gathers from its own elements, so no two threads write the same value
+    const auto nodeCount = static_cast<long>(nodeElementStart.size() - 1);
+#pragma omp parallel for if(parallel)
+    for (long node = 0; node < nodeCount; ++node) {
+        for (int i = 0; i < 3; ++i) {
+            double force = loadingParameter * globalLoad(3 * node + i);
+            for (auto slot = nodeElementStart[node]; slot < nodeElementStart[node + 1]; ++slot) {
+                const auto end = nodeElements[slot];
+                force += elementForces[i + 3 * (end % 2)][end / 2];
+            }
+            residual(3 * node + i) = force * freeDegreesOfFreedom(3 * node + i);
+        }
+    }
+}
+
+double ElementArrays::criticalTimeStep() const {
+    return 2 / std::sqrt(largestEigenvalue);
+}
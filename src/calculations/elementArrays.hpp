@@ -0,0 +1,66 @@
+#ifndef SFEMS_ELEMENTARRAYS_HPP
+#define SFEMS_ELEMENTARRAYS_HPP
+
+#include <array>
+#include <vector>
+#include <Eigen/Dense>
+#include "BeamElement.hpp"
+#include "connectivity.hpp"
+
+/*
+ * The beam elements of a structure stored as one array per quantity (structure of arrays),
+ * for solvers that only need inner forces and take millions of steps.
+ * The inner forces are the same as those of BeamElement::calculateInnerForces,
+ * but are calculated straight from the displacement without keeping element states.
+ * The element loop vectorizes, and runs on several threads with OpenMP for large structures.
+ * Only the linear element (ElementType::LINEAR) is implemented.
+ */
+class ElementArrays {
+    const size_t elementCount;
+    const unsigned long long int degreesOfFreedom;
+    // First degree of freedom of the two nodes of every element
+    std::vector<unsigned int> firstOffset, secondOffset;
+    // The elements at every node as 2 * element + side, with side 1 for the second node of the element.
+    // The elements of node n are nodeElements[nodeElementStart[n]] until nodeElements[nodeElementStart[n + 1]]
+    std::vector<unsigned int> nodeElementStart, nodeElements;
+    // Undeformed beam vector, length and unit vector
+    std::vector<double> beamX, beamY, beamLength, unitX, unitY;
+    // EA / L and EI / L
+    std::vector<double> axialStiffness, bendingStiffness;
+    // Loads in the local coordinate system of every element, rotated with it
+    std::array<std::vector<double>, 6> localLoad;
+    // The global forces of every element before they are summed up at the nodes
+    std::array<std::vector<double>, 6> elementForces;
+    Eigen::VectorXd globalLoad;
+    // 1 for free and 0 for constrained degrees of freedom
+    Eigen::VectorXd freeDegreesOfFreedom;
+    Eigen::VectorXd lumpedMass;
+    // Largest eigenvalue of M^-1 K of every element, bounds the one of the structure
+    double largestEigenvalue = 0;
+
+public:
+    ElementArrays(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                  const ElementProperties &properties,
+                  const Eigen::VectorXd &nominalGlobalLoad, const Eigen::VectorXd &nominalLocalLoad,
+                  const std::vector<bool> &constrained);
+
+    /*
+     * Writes loadingParameter * q - f_int for the given displacement into residual,
+     * zero in the constrained degrees of freedom
+     */
+    void calculateResidual(const Eigen::VectorXd &displacement, double loadingParameter,
+                           Eigen::VectorXd &residual);
+
+    // Diagonal of the lumped mass matrix, as BeamElement::calculateMass
+    const Eigen::VectorXd &getLumpedMass() const { return lumpedMass; }
+
+    const Eigen::VectorXd &getFreeDegreesOfFreedom() const { return freeDegreesOfFreedom; }
+
+    /*
+     * Stable time step of the central difference method with the lumped mass, 2 / omega_max,
+     * estimated with the largest element frequency which is an upper bound of omega_max
+     */
+    double criticalTimeStep() const;
+};
+
+#endif //SFEMS_ELEMENTARRAYS_HPP
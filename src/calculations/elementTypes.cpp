@@ -0,0 +1,24 @@
+#include "elementTypes.hpp"
+
+ElementVector createElements(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                             const ElementProperties &properties) {
+    auto coordinate = [&vertices](unsigned int node) {
+        return Eigen::Vector2d{vertices[2 * node], vertices[2 * node + 1]};
+    };
+    if (properties.type == ElementType::HIGHER_ORDER) {
+        const auto initialSlopes = calculateInitialSlopes(vertices, connectivity);
+        std::vector<HigherOrderBeamElement> elements;
+        elements.reserve(connectivity.size());
+        for (unsigned int e = 0; e < connectivity.size(); ++e) {
+            elements.emplace_back(coordinate(connectivity[e].first), coordinate(connectivity[e].second),
+                                  properties, e, initialSlopes[e]);
+        }
+        return elements;
+    }
+    std::vector<BeamElement> elements;
+    elements.reserve(connectivity.size());
+    for (unsigned int e = 0; e < connectivity.size(); ++e) {
+        elements.emplace_back(coordinate(connectivity[e].first), coordinate(connectivity[e].second), properties, e);
+    }
+    return elements;
+}
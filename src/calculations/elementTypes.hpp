@@ -0,0 +1,40 @@
+#ifndef SFEMS_ELEMENTTYPES_HPP
+#define SFEMS_ELEMENTTYPES_HPP
+
+#include <variant>
+#include <vector>
+#include "BeamElement.hpp"
+#include "HigherOrderBeamElement.hpp"
+#include "connectivity.hpp"
+
+/*
+ * The elements of a structure, all of one type in one array. The element loops are compiled for every type,
+ * so the element functions are called directly and can be inlined, there are no virtual calls per element.
+ * A new element type derives from CorotationalElement and is added here and to createElements.
+ */
+using ElementVector = std::variant<std::vector<BeamElement>, std::vector<HigherOrderBeamElement>>;
+
+/*
+ * Creates the elements of the type in the properties, numbered as the connectivity
+ */
+ElementVector createElements(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                             const ElementProperties &properties);
+
+/*
+ * Calls function(element) for every element in order, function is compiled for every element type
+ */
+template<typename Function>
+void forEachElement(ElementVector &elements, Function &&function) {
+    std::visit([&function](auto &typedElements) {
+        for (auto &element : typedElements) function(element);
+    }, elements);
+}
+
+template<typename Function>
+void forEachElement(const ElementVector &elements, Function &&function) {
+    std::visit([&function](const auto &typedElements) {
+        for (const auto &element : typedElements) function(element);
+    }, elements);
+}
+
+#endif //SFEMS_ELEMENTTYPES_HPP
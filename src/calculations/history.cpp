@@ -0,0 +1,142 @@
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "history.hpp"
+
+void HistoryWriter::writeHeader(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                                unsigned long long int degreesOfFreedom) {
+    HistoryHeader header{};
+    std::memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+    header.version = HISTORY_VERSION;
+    header.degreesOfFreedom = degreesOfFreedom;
+    header.vertexCoordinateCount = vertices.size();
+    header.elementCount = static_cast<uint32_t>(connectivity.size());
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(vertices.data()), sizeof(double) * vertices.size());
+    file.write(reinterpret_cast<const char *>(connectivity.data()), sizeof(ElementNodes) * connectivity.size());
+    file.flush();
+}
+
+void HistoryWriter::append(const Eigen::VectorXd &displacement, double loadingParameter,
+                           double residualNorm, unsigned int iterations, int negativePivots) {
+    HistoryRecord record{loadingParameter, residualNorm, iterations, negativePivots};
+    file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    file.write(reinterpret_cast<const char *>(displacement.data()), sizeof(double) * displacement.size());
+    // Flush every point so the file can be read while the calculation is still running
+    file.flush();
+}
+
+uint64_t HistoryWriter::size() const {
+    return std::filesystem::file_size(filename);
+}
+
+/*
+ * Cuts the history back to the given size in bytes and continues appending from there
+ */
+void HistoryWriter::truncate(uint64_t size) {
+    file.close();
+    std::filesystem::resize_file(filename, size);
+    file.open(filename, std::ios::binary | std::ios::app);
+}
+
+HistoryReader::HistoryReader(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Could not open history file " + filename);
+    struct stat status{};
+    fstat(fd, &status);
+    fileSize = static_cast<size_t>(status.st_size);
+    if (fileSize < sizeof(HistoryHeader)) {
+        close(fd);
+        throw std::runtime_error("History file " + filename + " is too small");
+    }
+    void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the file descriptor is closed
+    close(fd);
+    if (mapping == MAP_FAILED) throw std::runtime_error("Could not map history file " + filename);
+    data = static_cast<const char *>(mapping);
+    header = reinterpret_cast<const HistoryHeader *>(data);
+    if (std::memcmp(header->magic, HISTORY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version == 0 || header->version > HISTORY_VERSION) {
+        munmap(const_cast<char *>(data), fileSize);
+        throw std::runtime_error(filename + " is not a supported history file");
+    }
+    recordSize = sizeof(HistoryRecord) + sizeof(double) * header->degreesOfFreedom;
+    recordsOffset = sizeof(HistoryHeader) + sizeof(double) * header->vertexCoordinateCount +
+                    sizeof(ElementNodes) * header->elementCount;
+    recordCount = fileSize > recordsOffset ? (fileSize - recordsOffset) / recordSize : 0;
+}
+
+HistoryReader::~HistoryReader() {
+    munmap(const_cast<char *>(data), fileSize);
+}
+
+const char *HistoryReader::recordStart(size_t index) const {
+    return data + recordsOffset + index * recordSize;
+}
+
+std::vector<double> HistoryReader::getVertices() const {
+    auto vertices = reinterpret_cast<const double *>(data + sizeof(HistoryHeader));
+    return std::vector<double>(vertices, vertices + header->vertexCoordinateCount);
+}
+
+std::vector<ElementNodes> HistoryReader::getConnectivity() const {
+    if (header->elementCount == 0) return chainConnectivity(header->vertexCoordinateCount / 2);
+    auto elements = reinterpret_cast<const ElementNodes *>(
+            data + sizeof(HistoryHeader) + sizeof(double) * header->vertexCoordinateCount);
+    return std::vector<ElementNodes>(elements, elements + header->elementCount);
+}
+
+/*
+ * Returns the vertices displaced by the displacement stored in the given record
+ */
+std::vector<double> HistoryReader::getVertices(size_t index) const {
+    std::vector<double> displacedVertices(header->vertexCoordinateCount);
+    writeVertices(index, displacedVertices.data());
+    return displacedVertices;
+}
+
+/*
+ * Writes the vertices displaced by the displacement stored in the given record,
+ * displacedVertices must have room for vertexCoordinateCount() values
+ */
+void HistoryReader::writeVertices(size_t index, double *displacedVertices) const {
+    auto vertices = reinterpret_cast<const double *>(data + sizeof(HistoryHeader));
+    auto recordDisplacement = displacement(index);
+    for (int degreeOfFreedom = 0, vertexIndex = 0; degreeOfFreedom < recordDisplacement.size(); ++degreeOfFreedom) {
+        if ((degreeOfFreedom + 1) % 3 == 0) continue;
+        displacedVertices[vertexIndex] = vertices[vertexIndex] + recordDisplacement[degreeOfFreedom];
+        ++vertexIndex;
+    }
+}
+
+const HistoryRecord &HistoryReader::record(size_t index) const {
+    return *reinterpret_cast<const HistoryRecord *>(recordStart(index));
+}
+
+Eigen::Map<const Eigen::VectorXd> HistoryReader::displacement(size_t index) const {
+    return Eigen::Map<const Eigen::VectorXd>(
+            reinterpret_cast<const double *>(recordStart(index) + sizeof(HistoryRecord)),
+            static_cast<Eigen::Index>(header->degreesOfFreedom)
+    );
+}
+
+void writePointsFile(const HistoryReader &history, unsigned int node, unsigned int degreeOfFreedom,
+                     const std::string &filename) {
+    const auto relevantDegreeOfFreedom = node * 3 + degreeOfFreedom;
+    if (relevantDegreeOfFreedom >= history.degreesOfFreedom())
+        throw std::runtime_error("Degree of freedom is outside of the history");
+    std::ofstream points(filename);
+    points << std::scientific;
+    points << std::setprecision(10);
+    points << "0 0" << std::endl;
+    for (size_t i = 0; i < history.size(); ++i) {
+        points << history.displacement(i)(relevantDegreeOfFreedom) << " "
+               << history.record(i).loadingParameter << " "
+               << history.record(i).negativePivots << std::endl;
+    }
+}
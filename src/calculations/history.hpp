@@ -0,0 +1,110 @@
+#ifndef SFEMS_HISTORY_HPP
+#define SFEMS_HISTORY_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "connectivity.hpp"
+
+/*
+ * Binary history of every converged equilibrium point.
+ *
+ * The file is append-only and laid out so it can be memory-mapped and indexed directly:
+ *   HistoryHeader
+ *   double vertices[header.vertexCoordinateCount]        (undeformed node coordinates)
+ *   ElementNodes elements[header.elementCount]           (two uint32 node indices per element)
+ *   records, each a HistoryRecord followed by double displacement[header.degreesOfFreedom]
+ * All values are stored in native byte order.
+ * A trailing partial record (e.g. from a crashed run) is ignored when reading.
+ */
+const char HISTORY_MAGIC[8] = {'S', 'F', 'E', 'M', 'S', 'H', 'S', 'T'};
+const uint32_t HISTORY_VERSION = 3;
+
+struct HistoryHeader {
+    char magic[8];
+    uint32_t version;
+    // 0 in files before version 3, which are chains without stored elements
+    uint32_t elementCount;
+    uint64_t degreesOfFreedom;
+    uint64_t vertexCoordinateCount;
+};
+
+struct HistoryRecord {
+    double loadingParameter;
+    double residualNorm;
+    uint32_t iterations;
+    // Negative pivots of the tangent factorization, -1 if unknown (always 0 in version 1 files)
+    int32_t negativePivots;
+};
+
+class HistoryWriter {
+    std::string filename;
+    std::ofstream file;
+
+public:
+    /*
+     * append: continue an existing history instead of starting a new one
+     */
+    explicit HistoryWriter(const std::string &filename, bool append = false) :
+            filename(filename),
+            file(filename, std::ios::binary | (append ? std::ios::app : std::ios::trunc)) {}
+
+    void writeHeader(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                     unsigned long long int degreesOfFreedom);
+
+    void append(const Eigen::VectorXd &displacement, double loadingParameter,
+                double residualNorm, unsigned int iterations, int negativePivots);
+
+    uint64_t size() const;
+
+    void truncate(uint64_t size);
+};
+
+class HistoryReader {
+    const char *data = nullptr;
+    size_t fileSize = 0;
+    size_t recordsOffset = 0;
+    size_t recordSize = 0;
+    size_t recordCount = 0;
+    const HistoryHeader *header = nullptr;
+
+    const char *recordStart(size_t index) const;
+
+public:
+    explicit HistoryReader(const std::string &filename);
+
+    HistoryReader(const HistoryReader &) = delete;
+
+    HistoryReader &operator=(const HistoryReader &) = delete;
+
+    ~HistoryReader();
+
+    size_t size() const { return recordCount; }
+
+    unsigned long long int degreesOfFreedom() const { return header->degreesOfFreedom; }
+
+    std::vector<double> getVertices() const;
+
+    std::vector<ElementNodes> getConnectivity() const;
+
+    std::vector<double> getVertices(size_t index) const;
+
+    void writeVertices(size_t index, double *displacedVertices) const;
+
+    size_t vertexCoordinateCount() const { return header->vertexCoordinateCount; }
+
+    const HistoryRecord &record(size_t index) const;
+
+    Eigen::Map<const Eigen::VectorXd> displacement(size_t index) const;
+};
+
+/*
+ * Writes the displacement of one degree of freedom against the loading parameter
+ * in the same format as finalPoints.dat, so the result can be used with plot.plt
+ */
+void writePointsFile(const HistoryReader &history, unsigned int node, unsigned int degreeOfFreedom,
+                     const std::string &filename);
+
+#endif //SFEMS_HISTORY_HPP
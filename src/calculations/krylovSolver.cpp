@@ -0,0 +1,130 @@
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include "krylovSolver.hpp"
+
+void KrylovSolver::factorize(const Tangent &newTangent) {
+    tangent = &newTangent;
+    if (multigrid) {
+        multigrid->update(newTangent);
+        return;
+    }
+    inverseDiagonalBlocks = tangent->nodalDiagonalBlocks();
+    for (auto &block : inverseDiagonalBlocks) {
+        // Inverts the absolute value of the block, so the preconditioner stays positive definite
+        // even when the tangent is not (as required by both cg and minres)
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigenSolver(block);
+        Eigen::Vector3d inverseEigenvalues = eigenSolver.eigenvalues().cwiseAbs().cwiseMax(
+                std::numeric_limits<double>::min()).cwiseInverse();
+        block = eigenSolver.eigenvectors() * inverseEigenvalues.asDiagonal() * eigenSolver.eigenvectors().transpose();
+    }
+}
+
+Eigen::VectorXd KrylovSolver::precondition(const Eigen::VectorXd &r) const {
+    if (multigrid) return multigrid->apply(r);
+    Eigen::VectorXd z(r.size());
+    for (size_t node = 0; node < inverseDiagonalBlocks.size(); ++node) {
+        z.segment<3>(node * 3) = inverseDiagonalBlocks[node] * r.segment<3>(node * 3);
+    }
+    return z;
+}
+
+Eigen::VectorXd KrylovSolver::solve(const Eigen::VectorXd &b) {
+    const auto iterations = maxIterations > 0 ? maxIterations : static_cast<unsigned int>(10 * b.size());
+    if (method == KrylovMethod::CG) return conjugateGradient(b, iterations);
+    return minres(b, iterations);
+}
+
+/*
+ * Prints that a solve stopped at the iteration limit, the solution is only as accurate as the relative residual.
+ * Newton and the arc length method still check the true residual, but may need more iterations
+ */
+void reportIterationLimit(const char *method, unsigned int iterations, double relativeResidual) {
+    std::cout << method << " stopped after " << iterations << " iterations at relative residual "
+              << relativeResidual << std::endl;
+}
+
+Eigen::VectorXd KrylovSolver::conjugateGradient(const Eigen::VectorXd &b, unsigned int iterations) const {
+    Eigen::VectorXd x = Eigen::VectorXd::Zero(b.size());
+    Eigen::VectorXd r = b;
+    const double threshold = tolerance * b.norm();
+    if (r.norm() <= threshold) return x;
+    Eigen::VectorXd z = precondition(r);
+    Eigen::VectorXd p = z;
+    double rz = r.dot(z);
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration) {
+        Eigen::VectorXd q = tangent->apply(p);
+        const double curvature = p.dot(q);
+        if (!(curvature > 0))
+            throw std::runtime_error("cg needs a positive definite tangent, use minres after a critical point");
+        const double alpha = rz / curvature;
+        x += alpha * p;
+        r -= alpha * q;
+        if (r.norm() <= threshold) return x;
+        z = precondition(r);
+        const double nextRz = r.dot(z);
+        p = z + (nextRz / rz) * p;
+        rz = nextRz;
+    }
+    reportIterationLimit("cg", iterations, r.norm() / b.norm());
+    return x;
+}
+
+/*
+ * Preconditioned minres following Paige and Saunders,
+ * the residual is measured in the norm given by the preconditioner
+ */
+Eigen::VectorXd KrylovSolver::minres(const Eigen::VectorXd &b, unsigned int iterations) const {
+    const auto n = b.size();
+    Eigen::VectorXd x = Eigen::VectorXd::Zero(n);
+    Eigen::VectorXd r1 = b;
+    Eigen::VectorXd y = precondition(r1);
+    const double beta1 = std::sqrt(r1.dot(y));
+    if (beta1 == 0) return x;
+
+    Eigen::VectorXd r2 = r1;
+    Eigen::VectorXd w = Eigen::VectorXd::Zero(n);
+    Eigen::VectorXd w1(n);
+    Eigen::VectorXd w2 = Eigen::VectorXd::Zero(n);
+    double oldBeta = 0, beta = beta1;
+    double dBar = 0, epsilon = 0;
+    double phiBar = beta1;
+    double cs = -1, sn = 0;
+
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration) {
+        // Lanczos step
+        Eigen::VectorXd v = y / beta;
+        y = tangent->apply(v);
+        if (iteration > 0) y -= (beta / oldBeta) * r1;
+        const double alpha = v.dot(y);
+        y -= (alpha / beta) * r2;
+        r1 = r2;
+        r2 = y;
+        y = precondition(r2);
+        oldBeta = beta;
+        beta = std::sqrt(std::max(r2.dot(y), 0.0));
+
+        // Applies the previous rotation and computes the next one
+        const double oldEpsilon = epsilon;
+        const double delta = cs * dBar + sn * alpha;
+        const double gBar = sn * dBar - cs * alpha;
+        epsilon = sn * beta;
+        dBar = -cs * beta;
+        const double gamma = std::max(std::hypot(gBar, beta), std::numeric_limits<double>::epsilon());
+        cs = gBar / gamma;
+        sn = beta / gamma;
+        const double phi = cs * phiBar;
+        phiBar = sn * phiBar;
+
+        // Updates the solution
+        w1 = w2;
+        w2 = w;
+        w = (v - oldEpsilon * w1 - delta * w2) / gamma;
+        x += phi * w;
+
+        if (phiBar <= tolerance * beta1 || beta == 0) return x;
+    }
+    reportIterationLimit("minres", iterations, phiBar / beta1);
+    return x;
+}
@@ -0,0 +1,59 @@
+#ifndef SFEMS_KRYLOVSOLVER_HPP
+#define SFEMS_KRYLOVSOLVER_HPP
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Dense>
+#include "linearSolver.hpp"
+#include "multigrid.hpp"
+
+enum class KrylovMethod {
+    // Conjugate gradients, needs a positive definite tangent
+    CG,
+    // Minimal residual, also handles the indefinite tangent after buckling
+    MINRES
+};
+
+/*
+ * Matrix-free iterative solver, applies the tangent element by element and never assembles it.
+ * Preconditioned with the inverses of the 3x3 nodal diagonal blocks (block Jacobi),
+ * or for arches with a multigrid V-cycle, which keeps the iterations flat as the elements get more.
+ * The V-cycle is only positive definite with the tangent, so it is for cg and not for minres.
+ * cg throws on a tangent that is not positive definite, both methods print when they stop at the iteration limit.
+ */
+class KrylovSolver : public LinearSolver {
+    const KrylovMethod method;
+    // Relative residual to iterate to
+    const double tolerance;
+    // 0 uses ten times the amount of degrees of freedom
+    const unsigned int maxIterations;
+
+    const Tangent *tangent = nullptr;
+    std::vector<Eigen::Matrix3d> inverseDiagonalBlocks;
+    // Replaces the block Jacobi preconditioner if set
+    const std::unique_ptr<MultigridPreconditioner> multigrid;
+
+    Eigen::VectorXd precondition(const Eigen::VectorXd &r) const;
+
+    Eigen::VectorXd conjugateGradient(const Eigen::VectorXd &b, unsigned int iterations) const;
+
+    Eigen::VectorXd minres(const Eigen::VectorXd &b, unsigned int iterations) const;
+
+public:
+    explicit KrylovSolver(KrylovMethod method, double tolerance = 1e-10, unsigned int maxIterations = 0,
+                          std::unique_ptr<MultigridPreconditioner> multigrid = nullptr) :
+            method(method),
+            tolerance(tolerance),
+            maxIterations(maxIterations),
+            multigrid(std::move(multigrid)) {
+        if (this->multigrid && method == KrylovMethod::MINRES)
+            throw std::runtime_error("minres needs a positive definite preconditioner, not multigrid");
+    }
+
+    void factorize(const Tangent &tangent) override;
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b) override;
+};
+
+#endif //SFEMS_KRYLOVSOLVER_HPP
@@ -0,0 +1,75 @@
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "lanczos.hpp"
+
+EigenPairs lanczos(const LinearOperator &applyOperator, const LinearOperator &applyInnerProduct,
+                   const Eigen::VectorXd &start, unsigned int count,
+                   double tolerance, unsigned int maxIterations) {
+    const auto size = static_cast<unsigned int>(start.size());
+    if (maxIterations == 0 || maxIterations > size) maxIterations = size;
+
+    // The basis and the basis multiplied with B, so B is applied once per iteration
+    std::vector<Eigen::VectorXd> basis;
+    std::vector<Eigen::VectorXd> innerProductBasis;
+    std::vector<double> alpha;
+    std::vector<double> beta;
+
+    Eigen::VectorXd q = start;
+    Eigen::VectorXd Bq = applyInnerProduct(q);
+    double norm = std::sqrt(q.dot(Bq));
+    if (!(norm > 0)) throw std::runtime_error("Lanczos start vector has no length in the inner product");
+    q /= norm;
+    Bq /= norm;
+
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> ritz;
+    for (unsigned int j = 0; j < maxIterations; ++j) {
+        basis.push_back(q);
+        innerProductBasis.push_back(Bq);
+
+        Eigen::VectorXd w = applyOperator(q);
+        alpha.push_back(w.dot(Bq));
+        w -= alpha.back() * q;
+        if (j > 0) w -= beta.back() * basis[j - 1];
+        // Full reorthogonalization, the three term recurrence alone loses orthogonality as eigenvalues converge
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t i = 0; i < basis.size(); ++i) {
+                w -= w.dot(innerProductBasis[i]) * basis[i];
+            }
+        }
+        Eigen::VectorXd Bw = applyInnerProduct(w);
+        const double nextBeta = std::sqrt(std::max(w.dot(Bw), 0.0));
+
+        const auto steps = static_cast<Eigen::Index>(alpha.size());
+        Eigen::VectorXd diagonal = Eigen::Map<Eigen::VectorXd>(alpha.data(), steps);
+        Eigen::VectorXd subDiagonal = Eigen::Map<Eigen::VectorXd>(beta.data(), steps - 1);
+        ritz.computeFromTridiagonal(diagonal, subDiagonal);
+
+        // The residual of a Ritz pair is beta times the last component of its eigenvector
+        const bool exhausted = nextBeta <= tolerance * std::abs(ritz.eigenvalues()(steps - 1)) ||
+                               j + 1 == maxIterations;
+        bool converged = steps >= count;
+        for (Eigen::Index i = steps - 1; converged && i >= steps - count; --i) {
+            converged = nextBeta * std::abs(ritz.eigenvectors()(steps - 1, i)) <=
+                        tolerance * std::abs(ritz.eigenvalues()(i));
+        }
+        if (converged || exhausted) break;
+
+        beta.push_back(nextBeta);
+        q = w / nextBeta;
+        Bq = Bw / nextBeta;
+    }
+
+    const auto steps = static_cast<Eigen::Index>(alpha.size());
+    const auto found = std::min<Eigen::Index>(count, steps);
+    EigenPairs pairs{Eigen::VectorXd(found), Eigen::MatrixXd::Zero(size, found)};
+    for (Eigen::Index k = 0; k < found; ++k) {
+        // The eigenvalues of the tridiagonal matrix are sorted ascending
+        const auto i = steps - 1 - k;
+        pairs.values(k) = ritz.eigenvalues()(i);
+        for (Eigen::Index j = 0; j < steps; ++j) {
+            pairs.vectors.col(k) += ritz.eigenvectors()(j, i) * basis[j];
+        }
+    }
+    return pairs;
+}
@@ -0,0 +1,31 @@
+#ifndef SFEMS_LANCZOS_HPP
+#define SFEMS_LANCZOS_HPP
+
+#include <functional>
+#include <Eigen/Dense>
+
+typedef std::function<Eigen::VectorXd(const Eigen::VectorXd &)> LinearOperator;
+
+/*
+ * Eigenvalues in descending order, with the eigenvectors as columns
+ */
+struct EigenPairs {
+    Eigen::VectorXd values;
+    Eigen::MatrixXd vectors;
+};
+
+/*
+ * Lanczos iteration for the largest eigenvalues of an operator A that is self-adjoint
+ * in the inner product <x, y> = x^T B y, e.g. A = K^-1 M with B = M.
+ * Used in shift-invert form, where the largest eigenvalues of the inverse are
+ * the smallest of the original problem and converge in few iterations.
+ * Only A and B are applied, the basis is fully reorthogonalized.
+ * The eigenvectors are normalized in the inner product of B.
+ * start: the starting vector, must not be B-orthogonal to the wanted eigenvectors
+ * maxIterations: 0 allows as many iterations as degrees of freedom
+ */
+EigenPairs lanczos(const LinearOperator &applyOperator, const LinearOperator &applyInnerProduct,
+                   const Eigen::VectorXd &start, unsigned int count,
+                   double tolerance = 1e-10, unsigned int maxIterations = 0);
+
+#endif //SFEMS_LANCZOS_HPP
@@ -0,0 +1,80 @@
+#include <cmath>
+#include "linearSolver.hpp"
+
+void DirectSolver::factorize(const Tangent &tangent) {
+    Eigen::MatrixXd matrix = tangent.assemble();
+    factorization.compute(matrix);
+    useFallback = factorization.info() != Eigen::Success;
+    if (useFallback) fallback.compute(matrix);
+}
+
+Eigen::VectorXd DirectSolver::solve(const Eigen::VectorXd &b) {
+    if (useFallback) return fallback.solve(b);
+    return factorization.solve(b);
+}
+
+int DirectSolver::negativePivots() const {
+    if (useFallback) return -1;
+    return static_cast<int>((factorization.vectorD().array() < 0).count());
+}
+
+void SparseDirectSolver::factorize(const Tangent &newTangent) {
+    tangent = &newTangent;
+    Eigen::SparseMatrix<double> matrix = tangent->assembleSparse();
+    factorization.compute(matrix);
+    useFallback = factorization.info() != Eigen::Success;
+    if (useFallback) fallback.compute(matrix);
+}
+
+Eigen::VectorXd SparseDirectSolver::solve(const Eigen::VectorXd &b) {
+    const Eigen::VectorXd orderedB = tangent->toEliminationOrder(b);
+    if (useFallback) return tangent->fromEliminationOrder(fallback.solve(orderedB));
+    return tangent->fromEliminationOrder(factorization.solve(orderedB));
+}
+
+int SparseDirectSolver::negativePivots() const {
+    if (useFallback) return -1;
+    // The elimination order is a congruence transformation, so the inertia is that of the tangent
+    return static_cast<int>((factorization.vectorD().array() < 0).count());
+}
+
+void MixedPrecisionSolver::factorize(const Tangent &newTangent) {
+    tangent = &newTangent;
+    factorization.compute(tangent->assemble().cast<float>());
+    useFallback = factorization.info() != Eigen::Success;
+    fallbackFactorized = false;
+}
+
+Eigen::VectorXd MixedPrecisionSolver::solveWithFallback(const Eigen::VectorXd &b) {
+    useFallback = true;
+    if (!fallbackFactorized) {
+        fallback.factorize(*tangent);
+        fallbackFactorized = true;
+    }
+    return fallback.solve(b);
+}
+
+Eigen::VectorXd MixedPrecisionSolver::solve(const Eigen::VectorXd &b) {
+    if (useFallback) return solveWithFallback(b);
+
+    const double threshold = tolerance * b.norm();
+    Eigen::VectorXd x = factorization.solve(b.cast<float>()).cast<double>();
+    Eigen::VectorXd residual = b - tangent->apply(x);
+    double residualNorm = residual.norm();
+    for (unsigned int refinement = 0; residualNorm > threshold; ++refinement) {
+        if (refinement == maxRefinements || !std::isfinite(residualNorm)) return solveWithFallback(b);
+        x += factorization.solve(residual.cast<float>()).cast<double>();
+        residual = b - tangent->apply(x);
+        const double lastResidualNorm = residualNorm;
+        residualNorm = residual.norm();
+        // Stalls when the tangent is too badly conditioned for single precision
+        if (residualNorm > lastResidualNorm / 2) return solveWithFallback(b);
+    }
+    return x;
+}
+
+int MixedPrecisionSolver::negativePivots() const {
+    // Both factorizations are of the same tangent, so they have the same inertia
+    if (useFallback) return fallbackFactorized ? fallback.negativePivots() : -1;
+    return static_cast<int>((factorization.vectorD().array() < 0).count());
+}
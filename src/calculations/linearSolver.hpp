@@ -0,0 +1,98 @@
+#ifndef SFEMS_LINEARSOLVER_HPP
+#define SFEMS_LINEARSOLVER_HPP
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseLU>
+#include "tangent.hpp"
+
+/*
+ * Solves systems with the tangent stiffness of a structure
+ */
+class LinearSolver {
+public:
+    virtual ~LinearSolver() = default;
+
+    // Prepares for solving with a new tangent, the tangent must outlive the following solves
+    virtual void factorize(const Tangent &tangent) = 0;
+
+    virtual Eigen::VectorXd solve(const Eigen::VectorXd &b) = 0;
+
+    /*
+     * Number of negative pivots in the last factorization, which by Sylvester's law of inertia
+     * is the number of negative eigenvalues of the tangent. -1 when the solver can not tell.
+     */
+    virtual int negativePivots() const { return -1; }
+};
+
+/*
+ * Factorizes the assembled dense tangent with a pivoted LDL^T decomposition,
+ * falling back to QR if that fails
+ */
+class DirectSolver : public LinearSolver {
+    Eigen::LDLT<Eigen::MatrixXd> factorization;
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> fallback;
+    bool useFallback = false;
+
+public:
+    void factorize(const Tangent &tangent) override;
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b) override;
+
+    int negativePivots() const override;
+};
+
+/*
+ * Factorizes the tangent assembled as a sparse matrix with a LDL^T decomposition,
+ * so memory and time follow the nonzeros of the factor instead of the square of the degrees of freedom.
+ * Meant for frames with many elements. The degrees of freedom are eliminated in the order of the tangent,
+ * which the structure chooses to keep the fill small.
+ * Falls back to a sparse LU decomposition when a pivot vanishes.
+ */
+class SparseDirectSolver : public LinearSolver {
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::NaturalOrdering<int>> factorization;
+    Eigen::SparseLU<Eigen::SparseMatrix<double>, Eigen::NaturalOrdering<int>> fallback;
+    const Tangent *tangent = nullptr;
+    bool useFallback = false;
+
+public:
+    void factorize(const Tangent &tangent) override;
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b) override;
+
+    int negativePivots() const override;
+};
+
+/*
+ * Factorizes the tangent in single precision and recovers double precision accuracy
+ * by iterative refinement on the double precision residual.
+ * The residual is computed element by element from the tangent, so only the single precision matrix is kept.
+ * Falls back to the double precision DirectSolver when the refinement stalls,
+ * which happens when the tangent is badly conditioned close to limit points.
+ */
+class MixedPrecisionSolver : public LinearSolver {
+    // Relative residual the refinement iterates to
+    const double tolerance;
+    const unsigned int maxRefinements;
+
+    Eigen::LDLT<Eigen::MatrixXf> factorization;
+    const Tangent *tangent = nullptr;
+    bool useFallback = false;
+    bool fallbackFactorized = false;
+    DirectSolver fallback;
+
+    Eigen::VectorXd solveWithFallback(const Eigen::VectorXd &b);
+
+public:
+    explicit MixedPrecisionSolver(double tolerance = 1e-12, unsigned int maxRefinements = 10) :
+            tolerance(tolerance),
+            maxRefinements(maxRefinements) {}
+
+    void factorize(const Tangent &tangent) override;
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b) override;
+
+    int negativePivots() const override;
+};
+
+#endif //SFEMS_LINEARSOLVER_HPP
@@ -1,8 +1,19 @@
+#include <filesystem>
 #include "logger.hpp"
 
+/*
+ * Cuts a log file back to the given size and continues appending from there
+ */
+void truncateLog(std::ofstream &stream, const std::string &filename, uint64_t size) {
+    stream.close();
+    std::filesystem::resize_file(filename, size);
+    stream.open(filename, std::ios::app);
+}
+
 void Logger::logPrediction(const Eigen::VectorXd &displacement, double loadingParameter,
                            const Eigen::VectorXd &deltaDisplacement,
                            double deltaLoadingParameter) {
+    if (muted) return;
     predictorPoints << displacement(relevantDegreeOfFreedom) << " " << loadingParameter << " "
                     << deltaDisplacement(relevantDegreeOfFreedom) << " " << deltaLoadingParameter << std::endl;
 }
@@ -10,10 +21,67 @@ void Logger::logPrediction(const Eigen::VectorXd &displacement, double loadingPa
 void Logger::logCorrection(const Eigen::VectorXd &displacement, double loadingParameter,
                            const Eigen::VectorXd &deltaDisplacement,
                            double deltaLoadingParameter) {
+    if (muted) return;
     correctorPoints << displacement(relevantDegreeOfFreedom) << " " << loadingParameter << " "
                     << deltaDisplacement(relevantDegreeOfFreedom) << " " << deltaLoadingParameter << std::endl;
 }
 
-void Logger::logPoint(const Eigen::VectorXd &displacement, double loadingParameter) {
-    finalPoints << displacement(relevantDegreeOfFreedom) << " " << loadingParameter << std::endl;
-}
\ No newline at end of file
+void Logger::logStructure(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                          unsigned long long int degreesOfFreedom) {
+    // A resumed history already has its header
+    if (resume) return;
+    history.writeHeader(vertices, connectivity, degreesOfFreedom);
+    criticalModes.writeHeader(vertices, connectivity, degreesOfFreedom);
+}
+
+void Logger::startMesh(unsigned int mesh, unsigned int node) {
+    relevantDegreeOfFreedom = node * 3 + relevantDegreeOfFreedom % 3;
+    history = HistoryWriter(prefix + "history" + std::to_string(mesh) + ".bin");
+    criticalModes = HistoryWriter(prefix + "criticalModes" + std::to_string(mesh) + ".bin");
+    // The new files have no header yet, even when the run was resumed
+    resume = false;
+}
+
+void Logger::logPoint(const Eigen::VectorXd &displacement, double loadingParameter,
+                      double residualNorm, unsigned int iterations, int negativePivots) {
+    if (muted) return;
+    finalPoints << displacement(relevantDegreeOfFreedom) << " " << loadingParameter << " "
+                << negativePivots << std::endl;
+    history.append(displacement, loadingParameter, residualNorm, iterations, negativePivots);
+}
+
+void Logger::logCriticalPoint(const Eigen::VectorXd &displacement, double loadingParameter,
+                              int negativePivots, const std::string &type, const Eigen::VectorXd &mode) {
+    if (muted) return;
+    criticalPoints << displacement(relevantDegreeOfFreedom) << " " << loadingParameter << " "
+                   << negativePivots << " " << type << std::endl;
+    if (mode.size() > 0) criticalModes.append(mode, loadingParameter, 0, 0, negativePivots);
+}
+
+void Logger::logTimeStep(double time, const Eigen::VectorXd &displacement, double loadingParameter) {
+    if (muted) return;
+    timePoints << time << " " << displacement(relevantDegreeOfFreedom) << " " << loadingParameter << std::endl;
+}
+
+LoggerPositions Logger::getPositions() const {
+    // Every log is flushed after each line, so the file sizes are up to date
+    return LoggerPositions{
+            std::filesystem::file_size(prefix + "predictorPoints.dat"),
+            std::filesystem::file_size(prefix + "correctorPoints.dat"),
+            std::filesystem::file_size(prefix + "finalPoints.dat"),
+            std::filesystem::file_size(prefix + "criticalPoints.dat"),
+            history.size(),
+            criticalModes.size(),
+            std::filesystem::file_size(prefix + "timePoints.dat")
+    };
+}
+
+void Logger::truncate(const LoggerPositions &positions) {
+    truncateLog(predictorPoints, prefix + "predictorPoints.dat", positions.predictorPoints);
+    truncateLog(correctorPoints, prefix + "correctorPoints.dat", positions.correctorPoints);
+    truncateLog(finalPoints, prefix + "finalPoints.dat", positions.finalPoints);
+    truncateLog(criticalPoints, prefix + "criticalPoints.dat", positions.criticalPoints);
+    history.truncate(positions.history);
+    criticalModes.truncate(positions.criticalModes);
+    truncateLog(timePoints, prefix + "timePoints.dat", positions.timePoints);
+}
@@ -2,30 +2,73 @@
 #define SFEMS_LOGGER_HPP
 
 
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
+#include <string>
 #include <Eigen/Dense>
+#include "history.hpp"
+
+/*
+ * Sizes of the log files, used to cut them back to the state of a checkpoint
+ */
+struct LoggerPositions {
+    uint64_t predictorPoints;
+    uint64_t correctorPoints;
+    uint64_t finalPoints;
+    uint64_t criticalPoints;
+    uint64_t history;
+    uint64_t criticalModes;
+    uint64_t timePoints;
+};
 
 class Logger {
+    const std::string prefix;
+    bool resume;
     std::ofstream predictorPoints;
     std::ofstream correctorPoints;
     std::ofstream finalPoints;
-    const unsigned int relevantDegreeOfFreedom;
+    std::ofstream criticalPoints;
+    std::ofstream timePoints;
+    HistoryWriter history;
+    // Mode shapes of the localized critical points, each stored as the displacement of a record
+    HistoryWriter criticalModes;
+    unsigned int relevantDegreeOfFreedom;
+    bool muted = false;
+
+    static std::ios::openmode openMode(bool resume) {
+        return resume ? std::ios::app : std::ios::trunc;
+    }
 
 public:
 
-    explicit Logger(unsigned int node, unsigned int degreeOfFreedom) :
+    /*
+     * prefix: prepended to every log filename, lets several runs log side by side
+     * resume: append to existing log files instead of starting new ones
+     */
+    explicit Logger(unsigned int node, unsigned int degreeOfFreedom,
+                    const std::string &prefix = "", bool resume = false) :
             relevantDegreeOfFreedom(node * 3 + degreeOfFreedom),
-            predictorPoints("predictorPoints.dat"),
-            correctorPoints("correctorPoints.dat"),
-            finalPoints("finalPoints.dat") {
+            prefix(prefix),
+            resume(resume),
+            predictorPoints(prefix + "predictorPoints.dat", openMode(resume)),
+            correctorPoints(prefix + "correctorPoints.dat", openMode(resume)),
+            finalPoints(prefix + "finalPoints.dat", openMode(resume)),
+            criticalPoints(prefix + "criticalPoints.dat", openMode(resume)),
+            timePoints(prefix + "timePoints.dat", openMode(resume)),
+            history(prefix + "history.bin", resume),
+            criticalModes(prefix + "criticalModes.bin", resume) {
         predictorPoints << std::scientific;
         predictorPoints << std::setprecision(10);
         correctorPoints << std::scientific;
         correctorPoints << std::setprecision(10);
         finalPoints << std::scientific;
         finalPoints << std::setprecision(10);
-        finalPoints << "0 0" << std::endl;
+        criticalPoints << std::scientific;
+        criticalPoints << std::setprecision(10);
+        timePoints << std::scientific;
+        timePoints << std::setprecision(10);
+        if (!resume) finalPoints << "0 0" << std::endl;
     }
 
     void logPrediction(const Eigen::VectorXd &displacement, double loadingParameter,
@@ -35,7 +78,32 @@ public:
     void logCorrection(const Eigen::VectorXd &displacement, double loadingParameter,
                        const Eigen::VectorXd &deltaDisplacement, double deltaLoadingParameter);
 
-    void logPoint(const Eigen::VectorXd &displacement, double loadingParameter);
+    void logStructure(const std::vector<double> &vertices, const std::vector<ElementNodes> &connectivity,
+                      unsigned long long int degreesOfFreedom);
+
+    void logPoint(const Eigen::VectorXd &displacement, double loadingParameter,
+                  double residualNorm, unsigned int iterations, int negativePivots);
+
+    void logCriticalPoint(const Eigen::VectorXd &displacement, double loadingParameter,
+                          int negativePivots, const std::string &type, const Eigen::VectorXd &mode);
+
+    void logTimeStep(double time, const Eigen::VectorXd &displacement, double loadingParameter);
+
+    unsigned int getLoggedNode() const { return relevantDegreeOfFreedom / 3; }
+
+    /*
+     * Continues on an adapted mesh: a history holds a single mesh, so the history and critical modes
+     * of mesh number n go on in historyn.bin and criticalModesn.bin, whose headers logStructure writes
+     * node: the logged node in the new mesh
+     */
+    void startMesh(unsigned int mesh, unsigned int node);
+
+    // Ignores everything logged while muted, used for steps that are not part of the path
+    void setMuted(bool muted) { this->muted = muted; }
+
+    LoggerPositions getPositions() const;
+
+    void truncate(const LoggerPositions &positions);
 };
 
 
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "multigrid.hpp"
+
+/*
+ * The displacement of a point of a beam between the nodes a and b along the chord from a to b,
+ * as a 3x6 matrix of the displacements of a and b. The cubic Hermite shape functions give the deflection
+ * and rotation at the projection of the point, the rotation also moves points off the chord along it
+ */
+static Eigen::Matrix<double, 3, 6> beamInterpolation(const Eigen::Vector2d &a, const Eigen::Vector2d &b,
+                                                     const Eigen::Vector2d &point) {
+    const Eigen::Vector2d chord = b - a;
+    const double L = chord.norm();
+    const Eigen::Vector2d tangent = chord / L;
+    const Eigen::Vector2d normal{-tangent(1), tangent(0)};
+    const double xi = tangent.dot(point - a) / L;
+    const double offset = normal.dot(point - a);
+
+    // Axial displacement, deflection and rotation of a and b in the chord system
+    Eigen::Matrix<double, 1, 6> axialA, axialB, deflectionA, deflectionB, rotationA, rotationB;
+    axialA << tangent.transpose(), 0, 0, 0, 0;
+    axialB << 0, 0, 0, tangent.transpose(), 0;
+    deflectionA << normal.transpose(), 0, 0, 0, 0;
+    deflectionB << 0, 0, 0, normal.transpose(), 0;
+    rotationA << 0, 0, 1, 0, 0, 0;
+    rotationB << 0, 0, 0, 0, 0, 1;
+
+    const double xi2 = xi * xi, xi3 = xi2 * xi;
+    const Eigen::Matrix<double, 1, 6> deflection =
+            (1 - 3 * xi2 + 2 * xi3) * deflectionA + L * (xi - 2 * xi2 + xi3) * rotationA +
+            (3 * xi2 - 2 * xi3) * deflectionB + L * (xi3 - xi2) * rotationB;
+    const Eigen::Matrix<double, 1, 6> rotation =
+            6 * (xi2 - xi) / L * deflectionA + (1 - 4 * xi + 3 * xi2) * rotationA +
+            6 * (xi - xi2) / L * deflectionB + (3 * xi2 - 2 * xi) * rotationB;
+    const Eigen::Matrix<double, 1, 6> axial = (1 - xi) * axialA + xi * axialB - offset * rotation;
+
+    Eigen::Matrix<double, 3, 6> interpolation;
+    interpolation.row(0) = tangent(0) * axial + normal(0) * deflection;
+    interpolation.row(1) = tangent(1) * axial + normal(1) * deflection;
+    interpolation.row(2) = rotation;
+    return interpolation;
+}
+
+MultigridPreconditioner::MultigridPreconditioner(const std::vector<double> &vertices, unsigned int coarsestNodes) {
+    std::vector<Eigen::Vector2d> points(vertices.size() / 2);
+    for (size_t i = 0; i < points.size(); ++i) points[i] = {vertices[2 * i], vertices[2 * i + 1]};
+    coarsestNodes = std::max(coarsestNodes, 2u);
+    while (true) {
+        levels.emplace_back();
+        auto &level = levels.back();
+        const auto nodeCount = points.size();
+        level.diagonal.resize(nodeCount);
+        level.subDiagonal.resize(nodeCount);
+        for (auto *vector : {&level.rightHandSide, &level.solution, &level.residual}) {
+            vector->resize(static_cast<Eigen::Index>(3 * nodeCount));
+        }
+        if (nodeCount <= coarsestNodes) break;
+
+        // Every other node and the last one
+        std::vector<Eigen::Vector2d> coarsePoints;
+        level.coarseNodes.resize(nodeCount);
+        level.prolongation.resize(nodeCount);
+        for (size_t node = 0; node < nodeCount; ++node) {
+            if (node % 2 == 0 || node + 1 == nodeCount) {
+                const auto coarseNode = static_cast<unsigned int>(coarsePoints.size());
+                coarsePoints.push_back(points[node]);
+                level.coarseNodes[node] = {coarseNode, coarseNode};
+                level.prolongation[node] = {Eigen::Matrix3d::Identity(), Eigen::Matrix3d::Zero()};
+            }
+        }
+        for (size_t node = 1; node < nodeCount; node += 2) {
+            if (node + 1 == nodeCount) continue;
+            const auto interpolation = beamInterpolation(points[node - 1], points[node + 1], points[node]);
+            level.coarseNodes[node] = {level.coarseNodes[node - 1][0], level.coarseNodes[node + 1][0]};
+            level.prolongation[node] = {interpolation.leftCols<3>(), interpolation.rightCols<3>()};
+        }
+        points = std::move(coarsePoints);
+    }
+}
+
+/*
+ * The Galerkin product of the next coarser level, P^T A P
+ */
+void MultigridPreconditioner::restrictTangent(size_t index) {
+    const auto &level = levels[index];
+    auto &coarse = levels[index + 1];
+    std::fill(coarse.diagonal.begin(), coarse.diagonal.end(), Eigen::Matrix3d::Zero());
+    std::fill(coarse.subDiagonal.begin(), coarse.subDiagonal.end(), Eigen::Matrix3d::Zero());
+    const auto nodeCount = level.diagonal.size();
+    const auto interpolated = [&](size_t node) { return level.coarseNodes[node][0] != level.coarseNodes[node][1]; };
+    for (size_t row = 0; row < nodeCount; ++row) {
+        for (size_t column = row > 0 ? row - 1 : 0; column < std::min(row + 2, nodeCount); ++column) {
+            const Eigen::Matrix3d block = column == row ? level.diagonal[row] :
+                                          column < row ? level.subDiagonal[row] :
+                                          level.subDiagonal[column].transpose();
+            for (int k = 0; k < (interpolated(row) ? 2 : 1); ++k) {
+                for (int m = 0; m < (interpolated(column) ? 2 : 1); ++m) {
+                    const auto coarseRow = level.coarseNodes[row][k], coarseColumn = level.coarseNodes[column][m];
+                    if (coarseRow < coarseColumn) continue;
+                    auto &target = coarseRow == coarseColumn ? coarse.diagonal[coarseRow] : coarse.subDiagonal[coarseRow];
+                    target.noalias() += level.prolongation[row][k].transpose() * block * level.prolongation[column][m];
+                }
+            }
+        }
+    }
+    for (size_t node = 0; node < coarse.diagonal.size(); ++node) {
+        for (int i = 0; i < 3; ++i) {
+            if (coarse.constrained[3 * node + i]) coarse.diagonal[node](i, i) = 1;
+        }
+    }
+}
+
+void MultigridPreconditioner::update(const Tangent &tangent) {
+    auto &fine = levels.front();
+    const auto nodeCount = fine.diagonal.size();
+    if (tangent.size() != 3 * nodeCount) throw std::runtime_error("The multigrid tangent does not fit the arch");
+
+    // The constrained degrees of freedom do not move on any level, so the prolongation leaves them out
+    if (fine.constrained.empty()) {
+        fine.constrained.resize(3 * nodeCount);
+        for (size_t i = 0; i < 3 * nodeCount; ++i) fine.constrained[i] = tangent.isConstrained(i);
+        for (size_t index = 0; index + 1 < levels.size(); ++index) {
+            auto &level = levels[index];
+            auto &coarse = levels[index + 1];
+            coarse.constrained.resize(3 * coarse.diagonal.size());
+            for (size_t node = 0; node < level.diagonal.size(); ++node) {
+                if (level.coarseNodes[node][0] != level.coarseNodes[node][1]) continue;
+                for (int i = 0; i < 3; ++i) {
+                    coarse.constrained[3 * level.coarseNodes[node][0] + i] = level.constrained[3 * node + i];
+                }
+            }
+            for (size_t node = 0; node < level.diagonal.size(); ++node) {
+                for (int k = 0; k < 2; ++k) {
+                    for (int i = 0; i < 3; ++i) {
+                        if (level.constrained[3 * node + i]) level.prolongation[node][k].row(i).setZero();
+                        if (coarse.constrained[3 * level.coarseNodes[node][k] + i]) {
+                            level.prolongation[node][k].col(i).setZero();
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::fill(fine.diagonal.begin(), fine.diagonal.end(), Eigen::Matrix3d::Zero());
+    std::fill(fine.subDiagonal.begin(), fine.subDiagonal.end(), Eigen::Matrix3d::Zero());
+    for (size_t element = 0; element < tangent.elementCount(); ++element) {
+        const auto &map = tangent.elementMap(element);
+        const auto first = map[0] / 3, second = map[3] / 3;
+        if (first + 1 != second && second + 1 != first) {
+            throw std::runtime_error("Multigrid needs an arch, element " + std::to_string(element) +
+                                     " does not connect consecutive nodes");
+        }
+        Eigen::Matrix<double, 6, 6> stiffness = tangent.elementStiffness(element);
+        for (int i = 0; i < 6; ++i) {
+            if (!tangent.isConstrained(map[i])) continue;
+            stiffness.row(i).setZero();
+            stiffness.col(i).setZero();
+        }
+        fine.diagonal[first] += stiffness.topLeftCorner<3, 3>();
+        fine.diagonal[second] += stiffness.bottomRightCorner<3, 3>();
+        if (second > first) fine.subDiagonal[second] += stiffness.bottomLeftCorner<3, 3>();
+        else fine.subDiagonal[first] += stiffness.topRightCorner<3, 3>();
+    }
+    for (size_t node = 0; node < nodeCount; ++node) {
+        for (int i = 0; i < 3; ++i) {
+            if (fine.constrained[3 * node + i]) fine.diagonal[node](i, i) = 1;
+        }
+    }
+
+    for (size_t index = 0; index + 1 < levels.size(); ++index) {
+        auto &level = levels[index];
+        level.inverseDiagonal.resize(level.diagonal.size());
+        for (size_t node = 0; node < level.diagonal.size(); ++node) {
+            level.inverseDiagonal[node] = level.diagonal[node].inverse();
+        }
+        restrictTangent(index);
+    }
+
+    const auto &coarsest = levels.back();
+    const auto coarsestSize = static_cast<Eigen::Index>(3 * coarsest.diagonal.size());
+    Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(coarsestSize, coarsestSize);
+    for (size_t node = 0; node < coarsest.diagonal.size(); ++node) {
+        matrix.block<3, 3>(3 * node, 3 * node) = coarsest.diagonal[node];
+        if (node == 0) continue;
+        matrix.block<3, 3>(3 * node, 3 * (node - 1)) = coarsest.subDiagonal[node];
+        matrix.block<3, 3>(3 * (node - 1), 3 * node) = coarsest.subDiagonal[node].transpose();
+    }
+    coarsestFactorization.compute(matrix);
+}
+
+/*
+ * One block Gauss-Seidel sweep over the nodes of a level on its solution
+ */
+void MultigridPreconditioner::smooth(const Level &level, bool forward) const {
+    const auto nodeCount = level.diagonal.size();
+    auto &x = level.solution;
+    for (size_t k = 0; k < nodeCount; ++k) {
+        const size_t node = forward ? k : nodeCount - 1 - k;
+        Eigen::Vector3d b = level.rightHandSide.segment<3>(3 * node);
+        if (node > 0) b.noalias() -= level.subDiagonal[node] * x.segment<3>(3 * (node - 1));
+        if (node + 1 < nodeCount) b.noalias() -= level.subDiagonal[node + 1].transpose() * x.segment<3>(3 * (node + 1));
+        x.segment<3>(3 * node) = level.inverseDiagonal[node] * b;
+    }
+}
+
+/*
+ * V-cycle on a level from its right hand side into its solution
+ */
+void MultigridPreconditioner::cycle(size_t index) const {
+    const auto &level = levels[index];
+    if (index + 1 == levels.size()) {
+        level.solution = coarsestFactorization.solve(level.rightHandSide);
+        return;
+    }
+    const auto &coarse = levels[index + 1];
+    const auto nodeCount = level.diagonal.size();
+    level.solution.setZero();
+    smooth(level, true);
+
+    for (size_t node = 0; node < nodeCount; ++node) {
+        auto residual = level.residual.segment<3>(3 * node);
+        residual = level.rightHandSide.segment<3>(3 * node) - level.diagonal[node] * level.solution.segment<3>(3 * node);
+        if (node > 0) residual.noalias() -= level.subDiagonal[node] * level.solution.segment<3>(3 * (node - 1));
+        if (node + 1 < nodeCount) {
+            residual.noalias() -= level.subDiagonal[node + 1].transpose() * level.solution.segment<3>(3 * (node + 1));
+        }
+    }
+    coarse.rightHandSide.setZero();
+    for (size_t node = 0; node < nodeCount; ++node) {
+        const int parts = level.coarseNodes[node][0] != level.coarseNodes[node][1] ? 2 : 1;
+        for (int k = 0; k < parts; ++k) {
+            coarse.rightHandSide.segment<3>(3 * level.coarseNodes[node][k]).noalias() +=
+                    level.prolongation[node][k].transpose() * level.residual.segment<3>(3 * node);
+        }
+    }
+    cycle(index + 1);
+    for (size_t node = 0; node < nodeCount; ++node) {
+        const int parts = level.coarseNodes[node][0] != level.coarseNodes[node][1] ? 2 : 1;
+        for (int k = 0; k < parts; ++k) {
+            level.solution.segment<3>(3 * node).noalias() +=
+                    level.prolongation[node][k] * coarse.solution.segment<3>(3 * level.coarseNodes[node][k]);
+        }
+    }
+
+    smooth(level, false);
+}
+
+Eigen::VectorXd MultigridPreconditioner::apply(const Eigen::VectorXd &r) const {
+    levels.front().rightHandSide = r;
+    cycle(0);
+    return levels.front().solution;
+}
@@ -0,0 +1,58 @@
+#ifndef SFEMS_MULTIGRID_HPP
+#define SFEMS_MULTIGRID_HPP
+
+#include <array>
+#include <vector>
+#include <Eigen/Dense>
+#include "tangent.hpp"
+
+/*
+ * Geometric multigrid V-cycle for the tangent of an arch, a chain of elements where element i connects
+ * the nodes i and i + 1. Every coarser level keeps every other node of the level above,
+ * just as calculateArch with half the elementCount. The prolongation interpolates the displacement
+ * between two coarse nodes with the cubic Hermite shape functions of a beam along their chord,
+ * so it moves rigid bodies and bends beams exactly.
+ * The coarse tangents are the Galerkin products P^T A P, which stay block tridiagonal,
+ * smoothed with block Gauss-Seidel forward before and backward after the coarse correction,
+ * so the V-cycle is symmetric positive definite for a positive definite tangent as cg needs.
+ * The coarsest level is solved directly.
+ */
+class MultigridPreconditioner {
+    struct Level {
+        // The tangent in 3x3 node blocks, subDiagonal[i] is A(i, i - 1)
+        std::vector<Eigen::Matrix3d> diagonal, subDiagonal;
+        std::vector<Eigen::Matrix3d> inverseDiagonal;
+        std::vector<bool> constrained;
+        // For every node of this level the two nodes of the coarser level it is interpolated from,
+        // and their 3x3 blocks in the prolongation
+        std::vector<std::array<unsigned int, 2>> coarseNodes;
+        std::vector<std::array<Eigen::Matrix3d, 2>> prolongation;
+        // Work vectors of the V-cycle
+        mutable Eigen::VectorXd rightHandSide, solution, residual;
+    };
+
+    std::vector<Level> levels;
+    Eigen::LDLT<Eigen::MatrixXd> coarsestFactorization;
+
+    void restrictTangent(size_t level);
+
+    void smooth(const Level &level, bool forward) const;
+
+    void cycle(size_t level) const;
+
+public:
+    /*
+     * Builds the mesh hierarchy of the arch with the given vertices, down to at most coarsestNodes nodes
+     */
+    explicit MultigridPreconditioner(const std::vector<double> &vertices, unsigned int coarsestNodes = 32);
+
+    // Assembles the tangent on every level, throws if it is not the tangent of the arch
+    void update(const Tangent &tangent);
+
+    // One V-cycle for A z = r starting from z = 0
+    Eigen::VectorXd apply(const Eigen::VectorXd &r) const;
+
+    size_t levelCount() const { return levels.size(); }
+};
+
+#endif //SFEMS_MULTIGRID_HPP
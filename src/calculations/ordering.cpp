@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <stdexcept>
+#include "ordering.hpp"
+
+// Parts of nested dissection with at most this many nodes are not split any further
+const size_t DISSECTION_LEAF_SIZE = 8;
+
+/*
+ * The node adjacency of a structure in compressed form,
+ * the neighbours of node n are neighbours[start[n]] until neighbours[start[n + 1]]
+ */
+struct NodeGraph {
+    std::vector<unsigned int> start;
+    std::vector<unsigned int> neighbours;
+
+    unsigned int degree(unsigned int node) const { return start[node + 1] - start[node]; }
+};
+
+static NodeGraph buildNodeGraph(const std::vector<ElementNodes> &connectivity, size_t nodeCount) {
+    std::vector<std::vector<unsigned int>> adjacency(nodeCount);
+    for (const auto &nodes : connectivity) {
+        adjacency[nodes.first].push_back(nodes.second);
+        adjacency[nodes.second].push_back(nodes.first);
+    }
+    NodeGraph graph;
+    graph.start.push_back(0);
+    for (auto &neighbours : adjacency) {
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        graph.neighbours.insert(graph.neighbours.end(), neighbours.begin(), neighbours.end());
+        graph.start.push_back(static_cast<unsigned int>(graph.neighbours.size()));
+    }
+    return graph;
+}
+
+/*
+ * Breadth first search from root through the nodes in the given part of the region.
+ * Returns the reached nodes level by level and writes their level, which the caller has to reset to -1.
+ * depth: the number of levels
+ */
+static std::vector<unsigned int> levelStructure(const NodeGraph &graph, unsigned int root,
+                                                const std::vector<unsigned int> &region, unsigned int part,
+                                                std::vector<int> &level, unsigned int &depth) {
+    std::vector<unsigned int> reached{root};
+    level[root] = 0;
+    for (size_t i = 0; i < reached.size(); ++i) {
+        const auto node = reached[i];
+        for (auto j = graph.start[node]; j < graph.start[node + 1]; ++j) {
+            const auto neighbour = graph.neighbours[j];
+            if (region[neighbour] != part || level[neighbour] >= 0) continue;
+            level[neighbour] = level[node] + 1;
+            reached.push_back(neighbour);
+        }
+    }
+    depth = level[reached.back()] + 1;
+    return reached;
+}
+
+static void resetLevels(const std::vector<unsigned int> &nodes, std::vector<int> &level) {
+    for (auto node : nodes) level[node] = -1;
+}
+
+/*
+ * A node of high eccentricity in the part of the region containing start (George and Liu),
+ * the level structure from it is deep and narrow
+ */
+static unsigned int findPeripheralNode(const NodeGraph &graph, unsigned int start,
+                                       const std::vector<unsigned int> &region, unsigned int part,
+                                       std::vector<int> &level) {
+    unsigned int root = start;
+    unsigned int depth;
+    auto reached = levelStructure(graph, root, region, part, level, depth);
+    while (true) {
+        // The node of smallest degree in the last level
+        unsigned int candidate = reached.back();
+        for (auto it = reached.rbegin(); it != reached.rend() && level[*it] == static_cast<int>(depth) - 1; ++it) {
+            if (graph.degree(*it) < graph.degree(candidate)) candidate = *it;
+        }
+        resetLevels(reached, level);
+        unsigned int candidateDepth;
+        auto candidateReached = levelStructure(graph, candidate, region, part, level, candidateDepth);
+        if (candidateDepth <= depth) {
+            resetLevels(candidateReached, level);
+            return root;
+        }
+        root = candidate;
+        depth = candidateDepth;
+        reached = std::move(candidateReached);
+    }
+}
+
+static std::vector<unsigned int> reverseCuthillMcKee(const NodeGraph &graph, size_t nodeCount) {
+    std::vector<unsigned int> order;
+    order.reserve(nodeCount);
+    const std::vector<unsigned int> region(nodeCount, 0);
+    std::vector<int> level(nodeCount, -1);
+    std::vector<bool> visited(nodeCount, false);
+    std::vector<unsigned int> neighbours;
+    for (unsigned int start = 0; start < nodeCount; ++start) {
+        if (visited[start]) continue;
+        // Every connected component starts at a peripheral node
+        const auto root = findPeripheralNode(graph, start, region, 0, level);
+        visited[root] = true;
+        const size_t componentStart = order.size();
+        order.push_back(root);
+        for (size_t i = componentStart; i < order.size(); ++i) {
+            const auto node = order[i];
+            neighbours.clear();
+            for (auto j = graph.start[node]; j < graph.start[node + 1]; ++j) {
+                if (!visited[graph.neighbours[j]]) neighbours.push_back(graph.neighbours[j]);
+            }
+            std::sort(neighbours.begin(), neighbours.end(), [&](unsigned int a, unsigned int b) {
+                return graph.degree(a) < graph.degree(b);
+            });
+            for (auto neighbour : neighbours) {
+                visited[neighbour] = true;
+                order.push_back(neighbour);
+            }
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+/*
+ * Orders the given nodes by splitting them at the middle level of a level structure
+ * and ordering both halves before the separating level
+ */
+static void dissect(const NodeGraph &graph, const std::vector<unsigned int> &nodes,
+                    std::vector<unsigned int> &region, unsigned int &partCount, std::vector<int> &level,
+                    std::vector<unsigned int> &order) {
+    if (nodes.size() <= DISSECTION_LEAF_SIZE) {
+        order.insert(order.end(), nodes.begin(), nodes.end());
+        return;
+    }
+    const auto part = ++partCount;
+    for (auto node : nodes) region[node] = part;
+    const auto root = findPeripheralNode(graph, nodes.front(), region, part, level);
+    unsigned int depth;
+    const auto reached = levelStructure(graph, root, region, part, level, depth);
+
+    if (reached.size() < nodes.size()) {
+        // Not connected, the component of the root and the rest are ordered separately
+        std::vector<unsigned int> rest;
+        for (auto node : nodes) {
+            if (level[node] < 0) rest.push_back(node);
+        }
+        resetLevels(reached, level);
+        dissect(graph, reached, region, partCount, level, order);
+        dissect(graph, rest, region, partCount, level, order);
+        return;
+    }
+    if (depth < 3) {
+        resetLevels(reached, level);
+        order.insert(order.end(), nodes.begin(), nodes.end());
+        return;
+    }
+    const int separatorLevel = static_cast<int>(depth / 2);
+    std::vector<unsigned int> low, high, separator;
+    for (auto node : reached) {
+        if (level[node] < separatorLevel) low.push_back(node);
+        else if (level[node] > separatorLevel) high.push_back(node);
+        else separator.push_back(node);
+    }
+    resetLevels(reached, level);
+    dissect(graph, low, region, partCount, level, order);
+    dissect(graph, high, region, partCount, level, order);
+    order.insert(order.end(), separator.begin(), separator.end());
+}
+
+std::vector<unsigned int> orderNodes(const std::vector<ElementNodes> &connectivity, size_t nodeCount,
+                                     Ordering ordering) {
+    if (ordering == Ordering::NATURAL) {
+        std::vector<unsigned int> order(nodeCount);
+        for (unsigned int node = 0; node < nodeCount; ++node) order[node] = node;
+        return order;
+    }
+    const auto graph = buildNodeGraph(connectivity, nodeCount);
+    if (ordering == Ordering::REVERSE_CUTHILL_MCKEE) return reverseCuthillMcKee(graph, nodeCount);
+
+    std::vector<unsigned int> order;
+    order.reserve(nodeCount);
+    std::vector<unsigned int> nodes(nodeCount);
+    for (unsigned int node = 0; node < nodeCount; ++node) nodes[node] = node;
+    std::vector<unsigned int> region(nodeCount, 0);
+    std::vector<int> level(nodeCount, -1);
+    unsigned int partCount = 0;
+    dissect(graph, nodes, region, partCount, level, order);
+    return order;
+}
+
+std::vector<unsigned int> degreeOfFreedomPositions(const std::vector<unsigned int> &nodeOrder) {
+    std::vector<unsigned int> positions(3 * nodeOrder.size());
+    for (unsigned int k = 0; k < nodeOrder.size(); ++k) {
+        for (unsigned int i = 0; i < 3; ++i) positions[3 * nodeOrder[k] + i] = 3 * k + i;
+    }
+    return positions;
+}
+
+OrderingStatistics analyzeOrdering(const std::vector<ElementNodes> &connectivity,
+                                   const std::vector<unsigned int> &nodeOrder) {
+    const auto nodeCount = nodeOrder.size();
+    const auto graph = buildNodeGraph(connectivity, nodeCount);
+    std::vector<unsigned int> position(nodeCount);
+    for (unsigned int k = 0; k < nodeCount; ++k) position[nodeOrder[k]] = k;
+
+    // Every node couples its own three degrees of freedom, and every neighbour block is a full 3x3 block
+    OrderingStatistics statistics;
+    statistics.bandwidth = nodeCount > 0 ? 2 : 0;
+    for (unsigned int k = 0; k < nodeCount; ++k) {
+        const auto node = nodeOrder[k];
+        unsigned int first = k;
+        for (auto j = graph.start[node]; j < graph.start[node + 1]; ++j) {
+            first = std::min(first, position[graph.neighbours[j]]);
+        }
+        statistics.bandwidth = std::max<unsigned long long int>(statistics.bandwidth, 3ull * (k - first) + 2);
+        statistics.profile += 9ull * (k - first) + 3;
+    }
+
+    // Elimination tree of the node graph in this order (Liu), then the nonzero blocks of every row of the factor
+    std::vector<int> parent(nodeCount, -1);
+    std::vector<int> ancestor(nodeCount, -1);
+    for (unsigned int i = 0; i < nodeCount; ++i) {
+        const auto node = nodeOrder[i];
+        for (auto j = graph.start[node]; j < graph.start[node + 1]; ++j) {
+            int r = static_cast<int>(position[graph.neighbours[j]]);
+            if (r >= static_cast<int>(i)) continue;
+            while (ancestor[r] != -1 && ancestor[r] != static_cast<int>(i)) {
+                const int next = ancestor[r];
+                ancestor[r] = static_cast<int>(i);
+                r = next;
+            }
+            if (ancestor[r] == -1) {
+                ancestor[r] = static_cast<int>(i);
+                parent[r] = static_cast<int>(i);
+            }
+        }
+    }
+    std::vector<int> mark(nodeCount, -1);
+    unsigned long long int offDiagonalBlocks = 0;
+    for (unsigned int i = 0; i < nodeCount; ++i) {
+        mark[i] = static_cast<int>(i);
+        const auto node = nodeOrder[i];
+        for (auto j = graph.start[node]; j < graph.start[node + 1]; ++j) {
+            // Walks up the elimination tree until the row, every node passed is a nonzero block of the row
+            for (int k = static_cast<int>(position[graph.neighbours[j]]);
+                 k < static_cast<int>(i) && mark[k] != static_cast<int>(i); k = parent[k]) {
+                mark[k] = static_cast<int>(i);
+                ++offDiagonalBlocks;
+            }
+        }
+    }
+    statistics.fill = 9 * offDiagonalBlocks + 3 * nodeCount;
+    return statistics;
+}
+
+std::string orderingName(Ordering ordering) {
+    switch (ordering) {
+        case Ordering::NATURAL:
+            return "natural";
+        case Ordering::REVERSE_CUTHILL_MCKEE:
+            return "reverse Cuthill-McKee";
+        case Ordering::NESTED_DISSECTION:
+            return "nested dissection";
+    }
+    throw std::runtime_error("Unknown ordering");
+}
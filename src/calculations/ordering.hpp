@@ -0,0 +1,48 @@
+#ifndef SFEMS_ORDERING_HPP
+#define SFEMS_ORDERING_HPP
+
+#include <string>
+#include <vector>
+#include "connectivity.hpp"
+
+/*
+ * Order in which the nodes, and with them their degrees of freedom, are eliminated by the sparse factorizations
+ */
+enum class Ordering {
+    // The numbering of the nodes as given
+    NATURAL,
+    // Reverse Cuthill-McKee, keeps the nonzeros in a narrow band
+    REVERSE_CUTHILL_MCKEE,
+    // Recursive bisection with level set separators, which are eliminated last
+    NESTED_DISSECTION
+};
+
+/*
+ * Sparsity of the tangent of a structure in some ordering, counted in degrees of freedom
+ * bandwidth: largest distance of a nonzero from the diagonal
+ * profile: nonzeros below the diagonal inside the envelope, what a skyline factorization stores
+ * fill: nonzeros below the diagonal of the LDL^T factor, from a symbolic factorization
+ */
+struct OrderingStatistics {
+    unsigned long long int bandwidth = 0;
+    unsigned long long int profile = 0;
+    unsigned long long int fill = 0;
+};
+
+/*
+ * Returns the nodes in elimination order, every node appears once
+ */
+std::vector<unsigned int> orderNodes(const std::vector<ElementNodes> &connectivity, size_t nodeCount,
+                                     Ordering ordering);
+
+/*
+ * The position of every degree of freedom when the nodes are eliminated in the given order
+ */
+std::vector<unsigned int> degreeOfFreedomPositions(const std::vector<unsigned int> &nodeOrder);
+
+OrderingStatistics analyzeOrdering(const std::vector<ElementNodes> &connectivity,
+                                   const std::vector<unsigned int> &nodeOrder);
+
+std::string orderingName(Ordering ordering);
+
+#endif //SFEMS_ORDERING_HPP
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "scratchArray.hpp"
+
+ScratchArray::ScratchArray(std::string filename) : filename(std::move(filename)) {
+    if (this->filename.empty()) return;
+    file = open(this->filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (file < 0) throw std::runtime_error("Could not create scratch file " + this->filename);
+}
+
+ScratchArray::~ScratchArray() {
+    if (!isMapped()) return;
+    if (mapping) munmap(mapping, sizeof(double) * count);
+    close(file);
+    unlink(filename.c_str());
+}
+
+void ScratchArray::resize(size_t newCount) {
+    if (!isMapped()) {
+        memory.resize(newCount);
+        count = newCount;
+        return;
+    }
+    if (mapping) munmap(mapping, sizeof(double) * count);
+    mapping = nullptr;
+    count = newCount;
+    if (count == 0) return;
+    const auto size = static_cast<off_t>(sizeof(double) * count);
+    if (ftruncate(file, size) != 0) throw std::runtime_error("Could not resize scratch file " + filename);
+    void *newMapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (newMapping == MAP_FAILED) throw std::runtime_error("Could not map scratch file " + filename);
+    mapping = static_cast<double *>(newMapping);
+}
+
+/*
+ * The pages covering the values in [begin, end), madvise works on whole pages
+ */
+static void pageRange(const double *data, size_t begin, size_t end, char *&start, size_t &length) {
+    const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto first = reinterpret_cast<uintptr_t>(data + begin) / pageSize * pageSize;
+    const auto last = reinterpret_cast<uintptr_t>(data + end);
+    start = reinterpret_cast<char *>(first);
+    length = last - first;
+}
+
+void ScratchArray::prefetch(size_t begin, size_t end) const {
+    if (!mapping || begin >= end) return;
+    char *start;
+    size_t length;
+    pageRange(mapping, begin, std::min(end, count), start, length);
+    madvise(start, length, MADV_WILLNEED);
+}
+
+void ScratchArray::release(size_t begin, size_t end) const {
+    if (!mapping || begin >= end) return;
+    char *start;
+    size_t length;
+    pageRange(mapping, begin, std::min(end, count), start, length);
+    msync(start, length, MS_ASYNC);
+    // The values stay in the file, a shared mapping reads them again on the next access
+    madvise(start, length, MADV_DONTNEED);
+}
@@ -0,0 +1,48 @@
+#ifndef SFEMS_SCRATCHARRAY_HPP
+#define SFEMS_SCRATCHARRAY_HPP
+
+#include <string>
+#include <vector>
+
+/*
+ * An array of doubles in memory, or in a memory-mapped scratch file for arrays larger than the memory.
+ * The operating system pages a mapped array in and out, which users steer with prefetch and release
+ * so the pages they will need are read ahead and the ones they are done with are written back and dropped.
+ * The scratch file is removed again when the array is destroyed.
+ */
+class ScratchArray {
+    const std::string filename;
+    std::vector<double> memory;
+    double *mapping = nullptr;
+    size_t count = 0;
+    int file = -1;
+
+public:
+    // An empty filename keeps the array in memory
+    explicit ScratchArray(std::string filename = "");
+
+    ScratchArray(const ScratchArray &) = delete;
+
+    ScratchArray &operator=(const ScratchArray &) = delete;
+
+    ~ScratchArray();
+
+    // The values are undefined afterwards
+    void resize(size_t newCount);
+
+    size_t size() const { return count; }
+
+    bool isMapped() const { return !filename.empty(); }
+
+    double *data() { return mapping ? mapping : memory.data(); }
+
+    const double *data() const { return mapping ? mapping : memory.data(); }
+
+    // Starts reading the values in [begin, end) from the scratch file in the background
+    void prefetch(size_t begin, size_t end) const;
+
+    // Starts writing the values in [begin, end) back and frees their memory, they are read again when used
+    void release(size_t begin, size_t end) const;
+};
+
+#endif //SFEMS_SCRATCHARRAY_HPP
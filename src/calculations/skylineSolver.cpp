@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "skylineSolver.hpp"
+
+// Pivots this much smaller than the diagonal of the tangent count as vanished
+const double PIVOT_TOLERANCE = 1e-14;
+
+SkylineSolver::SkylineSolver(const std::string &scratchFilename, size_t panelSize) :
+        values(scratchFilename),
+        panelSize(scratchFilename.empty() ? 0 : panelSize) {}
+
+/*
+ * The envelope of the tangent in its elimination order, only reallocates the storage when it changed
+ */
+void SkylineSolver::findProfile(const Tangent &newTangent) {
+    const auto size = newTangent.size();
+    nextFirstColumn.resize(size);
+    for (size_t i = 0; i < size; ++i) nextFirstColumn[i] = static_cast<unsigned int>(i);
+    for (size_t element = 0; element < newTangent.elementCount(); ++element) {
+        const auto &map = newTangent.elementMap(element);
+        for (auto row : map) {
+            if (newTangent.isConstrained(row)) continue;
+            auto &first = nextFirstColumn[newTangent.position(row)];
+            for (auto column : map) {
+                if (newTangent.isConstrained(column)) continue;
+                first = std::min(first, static_cast<unsigned int>(newTangent.position(column)));
+            }
+        }
+    }
+    if (nextFirstColumn == firstColumn) return;
+
+    firstColumn = nextFirstColumn;
+    rowStart.resize(size + 1);
+    rowStart[0] = 0;
+    for (size_t i = 0; i < size; ++i) rowStart[i + 1] = rowStart[i] + i - firstColumn[i] + 1;
+    values.resize(rowStart[size]);
+    pivots.resize(size);
+    constrainedRow.assign(size, false);
+    for (size_t i = 0; i < size; ++i) {
+        if (newTangent.isConstrained(i)) constrainedRow[newTangent.position(i)] = true;
+    }
+    ordered.resize(static_cast<Eigen::Index>(size));
+    findPanels(newTangent);
+}
+
+/*
+ * Splits the rows into panels of at most panelSize values, and sorts the elements into the panels of their rows
+ */
+void SkylineSolver::findPanels(const Tangent &newTangent) {
+    const auto size = firstColumn.size();
+    panelStart.assign(1, 0);
+    for (size_t i = 0; i < size; ++i) {
+        if (panelSize > 0 && i > panelStart.back() && rowStart[i + 1] - rowStart[panelStart.back()] > panelSize) {
+            panelStart.push_back(i);
+        }
+    }
+    panelStart.push_back(size);
+
+    panelReach.assign(panelCount() + 1, size);
+    for (size_t panel = panelCount(); panel-- > 0;) {
+        panelReach[panel] = panelReach[panel + 1];
+        for (size_t i = panelStart[panel]; i < panelStart[panel + 1]; ++i) {
+            panelReach[panel] = std::min<size_t>(panelReach[panel], firstColumn[i]);
+        }
+    }
+
+    // Counting sort of the elements by panel, an element is in every panel one of its rows is in
+    const auto elementPanels = [&](size_t element, std::array<size_t, 6> &panels) {
+        int count = 0;
+        for (auto dof : newTangent.elementMap(element)) {
+            if (newTangent.isConstrained(dof)) continue;
+            const auto panel = static_cast<size_t>(std::upper_bound(panelStart.begin(), panelStart.end(),
+                                                                    newTangent.position(dof)) -
+                                                   panelStart.begin() - 1);
+            if (std::find(panels.begin(), panels.begin() + count, panel) == panels.begin() + count) {
+                panels[count++] = panel;
+            }
+        }
+        return count;
+    };
+    std::array<size_t, 6> panels{};
+    panelElementStart.assign(panelCount() + 1, 0);
+    for (size_t element = 0; element < newTangent.elementCount(); ++element) {
+        const int count = elementPanels(element, panels);
+        for (int k = 0; k < count; ++k) ++panelElementStart[panels[k] + 1];
+    }
+    for (size_t panel = 0; panel < panelCount(); ++panel) panelElementStart[panel + 1] += panelElementStart[panel];
+    panelElements.resize(panelElementStart.back());
+    std::vector<size_t> nextSlot(panelElementStart.begin(), panelElementStart.end() - 1);
+    for (size_t element = 0; element < newTangent.elementCount(); ++element) {
+        const int count = elementPanels(element, panels);
+        for (int k = 0; k < count; ++k) panelElements[nextSlot[panels[k]]++] = static_cast<unsigned int>(element);
+    }
+}
+
+/*
+ * Writes the rows of one panel of the tangent into the profile
+ */
+void SkylineSolver::assemble(const Tangent &newTangent, size_t panel) {
+    const auto firstRow = panelStart[panel], lastRow = panelStart[panel + 1];
+    std::fill(values.data() + rowStart[firstRow], values.data() + rowStart[lastRow], 0.0);
+    for (auto slot = panelElementStart[panel]; slot < panelElementStart[panel + 1]; ++slot) {
+        const auto element = panelElements[slot];
+        const auto &map = newTangent.elementMap(element);
+        const auto &stiffness = newTangent.elementStiffness(element);
+        for (int column = 0; column < 6; ++column) {
+            if (newTangent.isConstrained(map[column])) continue;
+            const auto columnPosition = newTangent.position(map[column]);
+            for (int row = 0; row < 6; ++row) {
+                if (newTangent.isConstrained(map[row])) continue;
+                const auto rowPosition = newTangent.position(map[row]);
+                if (rowPosition < firstRow || rowPosition >= lastRow || rowPosition < columnPosition) continue;
+                entry(rowPosition, columnPosition) += stiffness(row, column);
+            }
+        }
+    }
+    for (size_t i = firstRow; i < lastRow; ++i) {
+        if (constrainedRow[i]) entry(i, i) = 1;
+    }
+}
+
+/*
+ * Row by row LDL^T decomposition of one panel in place, the panels before it are decomposed.
+ * While row i is decomposed its entries hold L_ij D_j,
+ * so every entry only needs the dot product of two rows over their common part of the envelope.
+ * Returns false if a pivot vanished
+ */
+bool SkylineSolver::decompose(size_t panel) {
+    for (size_t i = panelStart[panel]; i < panelStart[panel + 1]; ++i) {
+        const size_t first = firstColumn[i];
+        double *row = &entry(i, first);
+        for (size_t j = first; j < i; ++j) {
+            const size_t start = std::max<size_t>(first, firstColumn[j]);
+            const auto length = static_cast<Eigen::Index>(j - start);
+            row[j - first] -= Eigen::Map<const Eigen::VectorXd>(rowValues(j) + start - firstColumn[j], length)
+                    .dot(Eigen::Map<const Eigen::VectorXd>(row + start - first, length));
+        }
+        const double diagonal = row[i - first];
+        double pivotValue = diagonal;
+        for (size_t j = first; j < i; ++j) {
+            const double scaled = row[j - first];
+            row[j - first] = scaled / pivots[j];
+            pivotValue -= scaled * row[j - first];
+        }
+        if (!std::isfinite(pivotValue) || std::abs(pivotValue) <= PIVOT_TOLERANCE * std::abs(diagonal)) return false;
+        row[i - first] = pivotValue;
+        pivots[i] = pivotValue;
+    }
+    return true;
+}
+
+void SkylineSolver::factorize(const Tangent &newTangent) {
+    tangent = &newTangent;
+    findProfile(newTangent);
+    useFallback = false;
+    // Rows before this one are no longer reached and have been released
+    size_t released = 0;
+    for (size_t panel = 0; panel < panelCount(); ++panel) {
+        if (panel + 1 < panelCount()) prefetchRows(panelStart[panel + 1], panelStart[panel + 2]);
+        assemble(newTangent, panel);
+        if (!decompose(panel)) {
+            useFallback = true;
+            break;
+        }
+        if (panelReach[panel + 1] > released) {
+            releaseRows(released, panelReach[panel + 1]);
+            released = panelReach[panel + 1];
+        }
+    }
+    if (useFallback) fallback.factorize(newTangent);
+}
+
+Eigen::VectorXd SkylineSolver::solve(const Eigen::VectorXd &b) {
+    if (useFallback) return fallback.solve(b);
+    const auto size = firstColumn.size();
+    for (size_t i = 0; i < size; ++i) ordered(tangent->position(i)) = b(i);
+    // L z = b row by row, then D y = z, then L^T x = y column by column
+    for (size_t panel = 0; panel < panelCount(); ++panel) {
+        if (panel + 1 < panelCount()) prefetchRows(panelStart[panel + 1], panelStart[panel + 2]);
+        for (size_t i = panelStart[panel]; i < panelStart[panel + 1]; ++i) {
+            const size_t first = firstColumn[i];
+            ordered(i) -= Eigen::Map<const Eigen::VectorXd>(rowValues(i), i - first).dot(
+                    ordered.segment(first, i - first));
+        }
+        releaseRows(panelStart[panel], panelStart[panel + 1]);
+    }
+    for (size_t i = 0; i < size; ++i) ordered(i) /= pivots[i];
+    for (size_t panel = panelCount(); panel-- > 0;) {
+        if (panel > 0) prefetchRows(panelStart[panel - 1], panelStart[panel]);
+        for (size_t i = panelStart[panel + 1]; i-- > panelStart[panel];) {
+            const size_t first = firstColumn[i];
+            ordered.segment(first, i - first) -=
+                    ordered(i) * Eigen::Map<const Eigen::VectorXd>(rowValues(i), i - first);
+        }
+        releaseRows(panelStart[panel], panelStart[panel + 1]);
+    }
+    Eigen::VectorXd x(size);
+    for (size_t i = 0; i < size; ++i) x(i) = ordered(tangent->position(i));
+    return x;
+}
+
+int SkylineSolver::negativePivots() const {
+    if (useFallback) return fallback.negativePivots();
+    return static_cast<int>(std::count_if(pivots.begin(), pivots.end(), [](double value) { return value < 0; }));
+}
@@ -0,0 +1,85 @@
+#ifndef SFEMS_SKYLINESOLVER_HPP
+#define SFEMS_SKYLINESOLVER_HPP
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "linearSolver.hpp"
+#include "scratchArray.hpp"
+
+/*
+ * LDL^T decomposition of the tangent stored in skyline (profile) form: every row of the lower triangle
+ * from its first nonzero to the diagonal, in the elimination order of the tangent.
+ * The decomposition only fills in inside this envelope, so it is stored in place of the tangent.
+ * The profile is found from the element maps on the first factorization and kept as long as the
+ * elements couple the same degrees of freedom, so later factorizations never allocate.
+ * There is no pivoting, when a pivot vanishes the SparseDirectSolver is used instead.
+ *
+ * Out of core the profile lives in a memory-mapped scratch file and is worked on in panels of consecutive rows.
+ * A panel is assembled and decomposed while the next one is prefetched, and the rows no later panel reaches
+ * back to are written back and dropped, so the memory holds about the envelope of one panel.
+ * The solves stream the panels forward and backward the same way.
+ */
+class SkylineSolver : public LinearSolver {
+    // Column of the first stored entry of every row, and where the row starts in values.
+    // The diagonal is the last entry of a row
+    std::vector<unsigned int> firstColumn;
+    std::vector<size_t> rowStart;
+    ScratchArray values;
+    // Copy of the diagonal of D, so the solves and the inertia do not read it back from the scratch file
+    std::vector<double> pivots;
+    // Rows of the constrained degrees of freedom, with 1 on the diagonal
+    std::vector<bool> constrainedRow;
+    // The profile of the latest tangent, compared with the stored one
+    std::vector<unsigned int> nextFirstColumn;
+    // Work vector of the solves
+    Eigen::VectorXd ordered;
+
+    // Largest number of values in a panel, 0 for a single panel
+    const size_t panelSize;
+    // First row of every panel, and the lowest row the rows from a panel on reach back to
+    std::vector<size_t> panelStart, panelReach;
+    // The elements with rows in panel p are panelElements[panelElementStart[p]] until panelElementStart[p + 1]
+    std::vector<size_t> panelElementStart;
+    std::vector<unsigned int> panelElements;
+
+    const Tangent *tangent = nullptr;
+    bool useFallback = false;
+    SparseDirectSolver fallback;
+
+    void findProfile(const Tangent &tangent);
+
+    void findPanels(const Tangent &tangent);
+
+    void assemble(const Tangent &tangent, size_t panel);
+
+    bool decompose(size_t panel);
+
+    size_t panelCount() const { return panelStart.size() - 1; }
+
+    // The values of rows [firstRow, lastRow)
+    void prefetchRows(size_t firstRow, size_t lastRow) const { values.prefetch(rowStart[firstRow], rowStart[lastRow]); }
+
+    void releaseRows(size_t firstRow, size_t lastRow) const { values.release(rowStart[firstRow], rowStart[lastRow]); }
+
+    double &entry(size_t row, size_t column) { return values.data()[rowStart[row] + column - firstColumn[row]]; }
+
+    const double *rowValues(size_t row) const { return values.data() + rowStart[row]; }
+
+public:
+    /*
+     * With a scratch filename the profile is kept out of core in that file, in panels of at most panelSize values
+     */
+    explicit SkylineSolver(const std::string &scratchFilename = "", size_t panelSize = 0);
+
+    void factorize(const Tangent &tangent) override;
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b) override;
+
+    int negativePivots() const override;
+
+    // Stored entries of the lower triangle including the diagonal
+    size_t profileSize() const { return values.size(); }
+};
+
+#endif //SFEMS_SKYLINESOLVER_HPP
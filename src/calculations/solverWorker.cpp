@@ -0,0 +1,221 @@
+#include <iostream>
+#include <stdexcept>
+#include "solverWorker.hpp"
+
+double chooseStepSize(const Structure &structure, const SolverSettings &settings) {
+    if (settings.stepSize > 0) return settings.stepSize;
+    return settings.arclength ? structure.getTuning().arcLength : structure.getTuning().loadStep;
+}
+
+bool runIncrement(Structure &structure, const SolverSettings &settings) {
+    if (settings.explicitDynamic) return structure.explicitSteps(settings.explicitDynamics);
+    if (settings.dynamic) return structure.timeStep(settings.dynamics, settings.tolerance, settings.maxIterations);
+    const double stepSize = chooseStepSize(structure, settings);
+    bool diverging;
+    if (settings.relaxation)
+        diverging = structure.relax(settings.relaxationSettings, stepSize, settings.tolerance);
+    else if (settings.arclength)
+        diverging = structure.arcLength(stepSize, settings.tolerance, settings.maxIterations);
+    else
+        diverging = structure.newton(stepSize, settings.tolerance, settings.maxIterations);
+    // A diverged increment is no equilibrium, the last checkpoint stays the restart point
+    if (!diverging && settings.checkpointInterval > 0 &&
+        structure.getIncrement() % settings.checkpointInterval == 0)
+        structure.saveCheckpoint(settings.checkpointFilename);
+    return diverging;
+}
+
+bool adaptIfDue(std::unique_ptr<Structure> &structure, const SolverSettings &settings) {
+    if (settings.adaptivity.interval == 0 || structure->getIncrement() % settings.adaptivity.interval != 0)
+        return false;
+    bool diverging;
+    auto adapted = structure->adapt(settings.adaptivity, settings.tolerance, settings.maxIterations,
+                                     settings.arclength, diverging);
+    if (adapted) structure = std::move(adapted);
+    return diverging;
+}
+
+BranchRunner::BranchRunner(StructureFactory factory, const SolverSettings &settings) :
+        factory(std::move(factory)),
+        settings(settings) {
+    // Only the primary path writes checkpoints
+    this->settings.checkpointInterval = 0;
+}
+
+BranchRunner::~BranchRunner() {
+    stopRequested = true;
+    join();
+}
+
+void BranchRunner::check(const Structure &structure) {
+    if (!settings.branchSwitching) return;
+    const auto &point = structure.getLastCriticalPoint();
+    if (point.type != CriticalPoint::BIFURCATION || point.mode.size() == 0) return;
+    const auto branch = "branch" + std::to_string(threads.size() + 1) + "_";
+    std::cout << "Following the secondary branch at loadingParameter " << point.loadingParameter
+              << ", logged with prefix " << branch << std::endl;
+    threads.emplace_back(&BranchRunner::follow, this, point, branch);
+}
+
+void BranchRunner::follow(const CriticalPointResult &point, const std::string &branch) {
+    // Runs on its own thread, an error only ends this branch
+    try {
+        auto structure = factory(branch);
+        bool diverging = structure->switchBranch(point, chooseStepSize(*structure, settings), settings.tolerance,
+                                                 settings.maxIterations);
+        for (unsigned int i = 1; i < settings.branchIncrements && !diverging && !stopRequested; ++i) {
+            diverging = runIncrement(*structure, settings) || adaptIfDue(structure, settings);
+        }
+        if (diverging)
+            std::cout << "Branch " << branch << " diverged at increment " << structure->getIncrement() << std::endl;
+    } catch (const std::exception &error) {
+        std::cout << "Branch " << branch << " stopped: " << error.what() << std::endl;
+    }
+}
+
+void BranchRunner::join() {
+    for (auto &thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+SolverWorker::SolverWorker(std::function<void()> onPublish) :
+        onPublish(std::move(onPublish)),
+        thread(&SolverWorker::work, this) {}
+
+SolverWorker::~SolverWorker() {
+    stopRequested = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        commands.clear();
+    }
+    condition.notify_one();
+    thread.join();
+}
+
+void SolverWorker::step() {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.push_back(SolverCommand{SolverCommandType::STEP, 1, {}, {}});
+    condition.notify_one();
+}
+
+void SolverWorker::run(unsigned int count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.push_back(SolverCommand{SolverCommandType::RUN, count, {}, {}});
+    condition.notify_one();
+}
+
+void SolverWorker::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.clear();
+    stopRequested = true;
+}
+
+void SolverWorker::modes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.push_back(SolverCommand{SolverCommandType::MODES, 0, {}, {}});
+    condition.notify_one();
+}
+
+void SolverWorker::reload(StructureFactory factory, const SolverSettings &newSettings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.clear();
+    stopRequested = true;
+    commands.push_back(SolverCommand{SolverCommandType::RELOAD, 0, std::move(factory), newSettings});
+    condition.notify_one();
+}
+
+void SolverWorker::work() {
+    while (true) {
+        SolverCommand command;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return quit || !commands.empty(); });
+            if (quit) return;
+            command = std::move(commands.front());
+            commands.pop_front();
+            // A stop only applies to the command that was running when it was requested
+            stopRequested = false;
+        }
+        execute(command);
+        bool busy;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = !commands.empty();
+        }
+        publish(busy);
+    }
+}
+
+void SolverWorker::execute(const SolverCommand &command) {
+    switch (command.type) {
+        case SolverCommandType::RELOAD:
+            // Destroy the old structure first so its logs are closed before the new ones are opened
+            branches.reset();
+            structure.reset();
+            settings = command.settings;
+            modal = ModalAnalysis{};
+            // A structure that cannot be set up, e.g. tuned to a load it does not buckle under, leaves none
+            try {
+                structure = command.factory("");
+                branches = std::make_unique<BranchRunner>(command.factory, settings);
+            } catch (const std::exception &error) {
+                std::cout << error.what() << std::endl;
+                structure.reset();
+            }
+            break;
+        case SolverCommandType::MODES:
+            if (!structure) break;
+            try {
+                modal = structure->modalAnalysis(settings.modeCount, settings.massType);
+            } catch (const std::runtime_error &error) {
+                std::cout << error.what() << std::endl;
+            }
+            break;
+        case SolverCommandType::STEP:
+        case SolverCommandType::RUN:
+            if (!structure) break;
+            // The modes belong to the state they were calculated for
+            modal = ModalAnalysis{};
+            // A solver that cannot go on stops the command, not the solver thread
+            try {
+                for (unsigned int i = 0; i < command.count && !stopRequested; ++i) {
+                    if (runIncrement(*structure, settings)) {
+                        std::cout << "Diverged at increment " << structure->getIncrement() << std::endl;
+                        break;
+                    }
+                    branches->check(*structure);
+                    if (adaptIfDue(structure, settings)) {
+                        std::cout << "Lost the equilibrium on the adapted mesh at increment "
+                                  << structure->getIncrement() << std::endl;
+                        break;
+                    }
+                    if (i + 1 < command.count) publish(true);
+                }
+            } catch (const std::exception &error) {
+                std::cout << "Stopped at increment " << structure->getIncrement() << ": " << error.what()
+                          << std::endl;
+            }
+            break;
+    }
+}
+
+void SolverWorker::publish(bool busy) {
+    if (!structure) return;
+    auto &snapshot = snapshots.writeBuffer();
+    snapshot.vertices = structure->getVertices();
+    snapshot.connectivity = structure->getConnectivity();
+    snapshot.mesh = structure->getMesh();
+    snapshot.increment = structure->getIncrement();
+    snapshot.loadingParameter = structure->getLoadingParameter();
+    snapshot.negativePivots = structure->getNegativePivots();
+    snapshot.frequencies.assign(modal.frequencies.data(), modal.frequencies.data() + modal.frequencies.size());
+    snapshot.modes.clear();
+    for (Eigen::Index i = 0; i < modal.modes.cols(); ++i) {
+        snapshot.modes.emplace_back(modal.modes.col(i));
+    }
+    snapshot.busy = busy;
+    snapshots.publish();
+    if (onPublish) onPublish();
+}
@@ -0,0 +1,180 @@
+#ifndef SFEMS_SOLVERWORKER_HPP
+#define SFEMS_SOLVERWORKER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "structure.hpp"
+#include "../utils/tripleBuffer.hpp"
+
+struct SolverSettings {
+    bool arclength;
+    // Time integration instead of a static continuation, every increment is a time step
+    bool dynamic;
+    DynamicsSettings dynamics;
+    // Explicit time integration, every increment is ExplicitSettings::steps time steps
+    bool explicitDynamic;
+    ExplicitSettings explicitDynamics;
+    // Load increments that find the equilibrium by dynamic relaxation instead of Newton iterations
+    bool relaxation;
+    RelaxationSettings relaxationSettings;
+    // 0 uses the step size tuned from the linear buckling load
+    double stepSize;
+    double tolerance;
+    int maxIterations;
+    // Checkpoints are written every checkpointInterval increments, 0 disables them.
+    // They do not hold the velocities, so they are not written during time integration
+    std::string checkpointFilename;
+    unsigned int checkpointInterval;
+    // Follows the secondary branch of every localized bifurcation point for branchIncrements increments
+    bool branchSwitching;
+    unsigned int branchIncrements;
+    // Modal analysis
+    unsigned int modeCount;
+    MassType massType;
+    // Refines and coarsens the mesh every adaptivity.interval increments, see Structure::adapt
+    AdaptivitySettings adaptivity;
+};
+
+/*
+ * The configured step size, or the one tuned by the structure
+ */
+double chooseStepSize(const Structure &structure, const SolverSettings &settings);
+
+/*
+ * Runs a single increment and writes a checkpoint when one is due, returns whether it diverged
+ */
+bool runIncrement(Structure &structure, const SolverSettings &settings);
+
+/*
+ * Moves the structure onto an adapted mesh when an adaptation is due, returns whether it diverged there
+ */
+bool adaptIfDue(std::unique_ptr<Structure> &structure, const SolverSettings &settings);
+
+/*
+ * Creates a structure, called on the solver thread so the old structure is gone before the new one opens its logs
+ * branch: name of a secondary branch, prepended to the log filenames; empty for the primary path
+ */
+typedef std::function<std::unique_ptr<Structure>(const std::string &branch)> StructureFactory;
+
+/*
+ * Follows secondary branches on their own threads, each with its own structure and logs,
+ * while the primary path continues.
+ */
+class BranchRunner {
+    const StructureFactory factory;
+    SolverSettings settings;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopRequested{false};
+
+    void follow(const CriticalPointResult &point, const std::string &branch);
+
+public:
+    BranchRunner(StructureFactory factory, const SolverSettings &settings);
+
+    BranchRunner(const BranchRunner &) = delete;
+
+    BranchRunner &operator=(const BranchRunner &) = delete;
+
+    // Stops all branches after their current increment
+    ~BranchRunner();
+
+    // Starts a branch if the last increment of the primary path passed a localized bifurcation point
+    void check(const Structure &structure);
+
+    // Waits until every branch has finished
+    void join();
+};
+
+/*
+ * The state of the structure after an increment, as seen by the viewer
+ */
+struct SolverSnapshot {
+    std::vector<double> vertices;
+    // The elements change whenever the mesh is adapted, which increases mesh
+    std::vector<ElementNodes> connectivity;
+    unsigned int mesh = 0;
+    unsigned int increment = 0;
+    double loadingParameter = 0;
+    int negativePivots = 0;
+    // Natural frequencies and mode shapes of the current state, empty until requested
+    std::vector<double> frequencies;
+    std::vector<Eigen::VectorXd> modes;
+    // Whether the solver still has queued work
+    bool busy = false;
+};
+
+enum class SolverCommandType {
+    STEP, RUN, RELOAD, MODES
+};
+
+struct SolverCommand {
+    SolverCommandType type;
+    unsigned int count;
+    StructureFactory factory;
+    SolverSettings settings;
+};
+
+/*
+ * Owns the structure and runs the solver on a separate thread, so the window stays responsive.
+ * Commands are queued from the main thread and results are published as snapshots.
+ */
+class SolverWorker {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<SolverCommand> commands;
+    bool quit = false;
+    std::atomic<bool> stopRequested{false};
+
+    // Only used on the solver thread
+    std::unique_ptr<Structure> structure;
+    SolverSettings settings{};
+    std::unique_ptr<BranchRunner> branches;
+    ModalAnalysis modal;
+
+    TripleBuffer<SolverSnapshot> snapshots;
+    // Called after every published snapshot, e.g. to wake up the render loop
+    const std::function<void()> onPublish;
+
+    std::thread thread;
+
+    void work();
+
+    void execute(const SolverCommand &command);
+
+    void publish(bool busy);
+
+public:
+    explicit SolverWorker(std::function<void()> onPublish);
+
+    SolverWorker(const SolverWorker &) = delete;
+
+    SolverWorker &operator=(const SolverWorker &) = delete;
+
+    ~SolverWorker();
+
+    void step();
+
+    void run(unsigned int count);
+
+    // Stops the running command after the current increment and drops all queued commands
+    void stop();
+
+    void reload(StructureFactory factory, const SolverSettings &newSettings);
+
+    // Calculates the natural frequencies and mode shapes of the current state
+    void modes();
+
+    // Picks up the newest snapshot, returns whether it changed
+    bool updateSnapshot() { return snapshots.update(); }
+
+    const SolverSnapshot &getSnapshot() const { return snapshots.readBuffer(); }
+};
+
+#endif //SFEMS_SOLVERWORKER_HPP
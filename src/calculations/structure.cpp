@@ -1,4 +1,7 @@
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include "lanczos.hpp"
 #include "structure.hpp"
 
 std::vector<double> Structure::getVertices() {
@@ -10,42 +13,199 @@ std::vector<double> Structure::getVertices() {
     return displacedVertices;
 }
 
-Eigen::MatrixXd Structure::calculateGlobalStiffnessMatrix() const {
-    Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(degreesOfFreedom, degreesOfFreedom);
-    for (auto &element : elements) {
-        matrix.block<6, 6>(element.index * 3, element.index * 3) += element.calculateTotalStiffness();
+std::vector<bool> Structure::findConstrainedDegreesOfFreedom(
+        const std::vector<BoundaryCondition> &boundaryConditions, unsigned long long int degreesOfFreedom) {
+    std::vector<bool> constrained(degreesOfFreedom, false);
+    for (auto boundaryCondition : boundaryConditions) {
+        auto degreeOfFreedom = boundaryCondition.globalDegreeOfFreedom < 0 ?
+                               degreesOfFreedom + boundaryCondition.globalDegreeOfFreedom :
+                               boundaryCondition.globalDegreeOfFreedom;
+        constrained[degreeOfFreedom] = true;
     }
-    return applyBoundaryConditions(matrix);
+    return constrained;
+}
+
+Eigen::VectorXd Structure::getNominalLoad() {
+    Eigen::VectorXd load = nominalGlobalLoad;
+    forEachElement(elements, [&](const auto &element) {
+        const auto &map = degreeOfFreedomMap[element.index];
+        scatterElement(load, map, element.localToGlobalRotationMatrix * gatherElement(nominalLocalLoad, map));
+    });
+    return load;
+}
+
+/*
+ * Chooses the elimination order of the tangent and reports how it changes the sparsity
+ */
+void Structure::orderDegreesOfFreedom(Ordering ordering) {
+    const auto nodeCount = vertices.size() / 2;
+    const auto nodeOrder = orderNodes(connectivity, nodeCount, ordering);
+    eliminationPositions = degreeOfFreedomPositions(nodeOrder);
+    tangent.setOrdering(eliminationPositions);
+    if (ordering == Ordering::NATURAL) return;
+
+    const auto natural = analyzeOrdering(connectivity, orderNodes(connectivity, nodeCount, Ordering::NATURAL));
+    const auto ordered = analyzeOrdering(connectivity, nodeOrder);
+    std::cout << "Ordering " << orderingName(ordering) << ": bandwidth " << natural.bandwidth << " -> "
+              << ordered.bandwidth << ", profile " << natural.profile << " -> " << ordered.profile
+              << ", fill " << natural.fill << " -> " << ordered.fill << std::endl;
 }
 
-Eigen::MatrixXd Structure::applyBoundaryConditions(Eigen::MatrixXd &stiffness) const {
-    for (auto bc : boundaryConditions) {
-        stiffness.row(bc.globalDegreeOfFreedom).setConstant(bc.value);
-        stiffness.col(bc.globalDegreeOfFreedom).setConstant(bc.value);
-        stiffness(bc.globalDegreeOfFreedom, bc.globalDegreeOfFreedom) = 1;
+/*
+ * Factorizes the current tangent, unless it is unchanged since the last factorization
+ */
+void Structure::factorize() {
+    if (tangentChanged) {
+        linearSolver->factorize(tangent);
+        tangentChanged = false;
+        factorizedMassFactor = massFactor;
     }
-    return stiffness;
 }
 
-Eigen::VectorXd Structure::getNominalLoad() {
-    Eigen::VectorXd load = nominalGlobalLoad;
-    for (auto &element : elements) {
-        const auto i = element.index * 3;
-        load.block<6, 1>(i, 0) +=
-                element.localToGlobalRotationMatrix * nominalLocalLoad.block<6, 1>(i, 0);
+/*
+ * Solves with the current tangent, which is only factorized again when it has changed
+ */
+Eigen::VectorXd Structure::solve(const Eigen::VectorXd &b) {
+    factorize();
+    return linearSolver->solve(b);
+}
+
+/*
+ * Compares the inertia of the tangent at a converged point with the last converged point.
+ * A change in the number of negative pivots means a critical point was passed in the increment.
+ * w = K^-1 q grows without bound and changes direction through a limit point,
+ * but stays continuous through a bifurcation point where the buckling mode is orthogonal to the load.
+ * direction: w for the current tangent
+ * lastDirection: w at the start of the increment
+ * Returns whether a critical point was passed
+ */
+bool Structure::detectCriticalPoint(const Eigen::VectorXd &direction, const Eigen::VectorXd &lastDirection) {
+    // Probing steps start from a known state and are only compared by the localization
+    if (localizing) return false;
+    const int pivots = linearSolver->negativePivots();
+    const bool passed = pivots >= 0 && negativePivots >= 0 && pivots != negativePivots;
+    lastCriticalPoint = CriticalPointResult{};
+    if (passed) {
+        lastCriticalPoint.type = direction.dot(lastDirection) < 0 ? CriticalPoint::LIMIT : CriticalPoint::BIFURCATION;
+        lastCriticalPoint.loadingParameter = loadingParameter;
+        lastCriticalPoint.negativePivots = pivots;
+        lastCriticalPoint.displacement = displacement;
     }
-    return load;
+    negativePivots = pivots;
+    return passed;
 }
 
-Eigen::VectorXd solve(const Eigen::MatrixXd &A, const Eigen::VectorXd &b) {
-//    return A.bdcSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(b);
-    return A.colPivHouseholderQr().solve(b);
+/*
+ * Bisects the step of the last increment until the change of the tangent inertia is bracketed
+ * within criticalPointTolerance of the step size.
+ * Every probe is a regular step from the start of the increment, so the same path is followed.
+ * A probe that does not converge is retried closer to the lower end of the bracket, if that keeps failing
+ * the critical point is left without a mode and state, so no branch is started from it.
+ * The structure is left at the end of the increment again.
+ * start: the state at the start of the increment
+ */
+void Structure::localizeCriticalPoint(const StructureState &start, double stepSize, double tolerance,
+                                      int maxIterations, bool arclength) {
+    // Halvings of a probe towards the lower end before the localization gives up
+    const int maxRetries = 4;
+    const StructureState end = getState();
+    StructureState upperState = end;
+    double lower = 0;
+    double upper = stepSize;
+    double lowerLoadingParameter = start.loadingParameter;
+    int retries = 0;
+    localizing = true;
+    logger.setMuted(true);
+    while (upper - lower > criticalPointTolerance * stepSize && retries <= maxRetries) {
+        const double probe = lower + (upper - lower) / std::pow(2, retries + 1);
+        setState(start);
+        bool diverging = arclength ? arcLength(probe, tolerance, maxIterations) :
+                         newton(probe, tolerance, maxIterations);
+        if (diverging) {
+            ++retries;
+            continue;
+        }
+        retries = 0;
+        update();
+        factorize();
+        if (linearSolver->negativePivots() == start.negativePivots) {
+            lower = probe;
+            lowerLoadingParameter = loadingParameter;
+        } else {
+            upper = probe;
+            upperState = getState();
+        }
+    }
+    if (retries <= maxRetries) {
+        setState(upperState);
+        lastCriticalPoint.state = upperState;
+        lastCriticalPoint.loadingParameter = loadingParameter;
+        lastCriticalPoint.displacement = displacement;
+        lastCriticalPoint.mode = calculateCriticalMode();
+    }
+    logger.setMuted(false);
+    localizing = false;
+    setState(end);
+    if (retries > maxRetries)
+        std::cout << "The critical point could not be localized, it lies between loadingParameter "
+                  << lowerLoadingParameter << " and " << upperState.loadingParameter << std::endl;
+}
+
+/*
+ * A start vector for eigenvector iterations, zero in the constrained degrees of freedom.
+ * Not symmetric, so that antisymmetric modes of symmetric structures are found as well
+ */
+Eigen::VectorXd Structure::createStartVector() const {
+    Eigen::VectorXd start = Eigen::VectorXd::LinSpaced(degreesOfFreedom, 1, 2);
+    for (unsigned long long int i = 0; i < degreesOfFreedom; ++i) {
+        if (tangent.isConstrained(i)) start(i) = 0;
+    }
+    return start.normalized();
+}
+
+/*
+ * Scales a mode shape to a largest translation of 1
+ */
+void Structure::normalizeMode(Eigen::VectorXd &mode) {
+    double largestTranslation = 0;
+    for (int i = 0; i < mode.size(); ++i) {
+        if (i % 3 != 2 && std::abs(mode(i)) > std::abs(largestTranslation)) largestTranslation = mode(i);
+    }
+    if (largestTranslation != 0) mode /= largestTranslation;
+}
+
+/*
+ * Inverse iteration with the current tangent, which is nearly singular at a critical point,
+ * returns the eigenvector of the eigenvalue closest to zero
+ */
+Eigen::VectorXd Structure::calculateCriticalMode() {
+    Eigen::VectorXd mode = createStartVector();
+    for (int iteration = 0; iteration < 50; ++iteration) {
+        Eigen::VectorXd next = solve(mode).normalized();
+        const double change = std::min((next - mode).norm(), (next + mode).norm());
+        mode = next;
+        if (change < 1e-10) break;
+    }
+    normalizeMode(mode);
+    return mode;
+}
+
+void Structure::reportCriticalPoint() {
+    const auto type = lastCriticalPoint.type == CriticalPoint::LIMIT ? "limit" : "bifurcation";
+    std::cout << (lastCriticalPoint.mode.size() > 0 ? "Critical " : "Passed a ") << type
+              << " point at loadingParameter " << lastCriticalPoint.loadingParameter
+              << " (negative pivots " << lastCriticalPoint.negativePivots << ")" << std::endl;
+    logger.logCriticalPoint(lastCriticalPoint.displacement, lastCriticalPoint.loadingParameter,
+                            lastCriticalPoint.negativePivots, type, lastCriticalPoint.mode);
 }
 
 bool Structure::newton(double stepSize, double tolerance, int maxIterations) {
+    StructureState start;
+    if (criticalPointTolerance > 0 && !localizing) start = getState();
+    ++increment;
     Eigen::VectorXd outerForces = getNominalLoad() * stepSize;
 
-    Eigen::VectorXd deltaDisplacement = solve(globalStiffness, outerForces);
+    Eigen::VectorXd deltaDisplacement = solve(outerForces);
 
     logger.logPrediction(displacement, loadingParameter, deltaDisplacement, stepSize);
 
@@ -57,16 +217,21 @@ bool Structure::newton(double stepSize, double tolerance, int maxIterations) {
 
     outerForces = getNominalLoad();
 
-    return newtonIterations(tolerance, maxIterations);
+    if (newtonIterations(tolerance, maxIterations, deltaDisplacement / stepSize)) return true;
+    if (lastCriticalPoint.type != CriticalPoint::NONE && !localizing) {
+        if (criticalPointTolerance > 0) localizeCriticalPoint(start, stepSize, tolerance, maxIterations, false);
+        reportCriticalPoint();
+    }
+    return false;
 }
 
-bool Structure::newtonIterations(double tolerance, int maxIterations) {
+bool Structure::newtonIterations(double tolerance, int maxIterations, const Eigen::VectorXd &lastDirection) {
     Eigen::VectorXd load = getNominalLoad() * loadingParameter;
     Eigen::VectorXd residual = load - innerForces;
     for (int iteration = 0; iteration < maxIterations; ++iteration) {
         update();
 
-        Eigen::VectorXd deltaDisplacement = globalStiffness.ldlt().solve(residual);
+        Eigen::VectorXd deltaDisplacement = solve(residual);
         logger.logCorrection(displacement, loadingParameter, deltaDisplacement, 0);
         displacement += deltaDisplacement;
 
@@ -74,16 +239,21 @@ bool Structure::newtonIterations(double tolerance, int maxIterations) {
 
         residual = load - innerForces;
         if (residual.norm() < tolerance) {
-            logger.logPoint(displacement, loadingParameter);
+            // The factorization is reused by the predictor of the next increment
+            if (!localizing) detectCriticalPoint(solve(getNominalLoad()), lastDirection);
+            logger.logPoint(displacement, loadingParameter, residual.norm(), iteration + 1, negativePivots);
             return false;
         }
     }
-    logger.logPoint(displacement, loadingParameter);
+    logger.logPoint(displacement, loadingParameter, residual.norm(), maxIterations, -1);
     return true;
 }
 
 bool Structure::arcLength(double stepSize, double tolerance, int maxIterations) {
-    Eigen::VectorXd w_q0 = solve(globalStiffness, getNominalLoad());
+    StructureState start;
+    if (criticalPointTolerance > 0 && !localizing) start = getState();
+    ++increment;
+    Eigen::VectorXd w_q0 = solve(getNominalLoad());
 
     double f = std::sqrt(1.0 + w_q0.transpose() * w_q0);
 
@@ -102,14 +272,25 @@ bool Structure::arcLength(double stepSize, double tolerance, int maxIterations)
     loadingParameter += deltaLambda;
     displacement += lastDeltaDisplacement;
 
+    return arcLengthIterations(stepSize, tolerance, maxIterations, w_q0, start);
+}
+
+/*
+ * The corrector of the arc length method, from a predicted point back to the equilibrium path
+ * w_q0: K^-1 q at the start of the increment
+ * start: the state at the start of the increment, only needed for the localization of critical points
+ */
+bool Structure::arcLengthIterations(double stepSize, double tolerance, int maxIterations,
+                                    const Eigen::VectorXd &w_q0, const StructureState &start) {
+    double residualNorm = 0;
     for (int iterator = 0; iterator < maxIterations; ++iterator) {
         update();
 
-        Eigen::VectorXd w_q = solve(globalStiffness, getNominalLoad());
+        Eigen::VectorXd w_q = solve(getNominalLoad());
 
         Eigen::VectorXd residual = getNominalLoad() * loadingParameter - innerForces;
 
-        Eigen::VectorXd w_r = solve(globalStiffness, residual);
+        Eigen::VectorXd w_r = solve(residual);
 
         double w_qW_r = w_q.transpose() * w_r;
         double dLambda = -(w_qW_r) / (1 + w_q.transpose() * w_q);
@@ -120,21 +301,407 @@ bool Structure::arcLength(double stepSize, double tolerance, int maxIterations)
         displacement += dDisplacement;
         loadingParameter += dLambda;
 
-        if (residual.norm() < tolerance) {
-            logger.logPoint(displacement, loadingParameter);
+        residualNorm = residual.norm();
+        if (residualNorm < tolerance) {
+            const bool passed = detectCriticalPoint(w_q, w_q0);
+            logger.logPoint(displacement, loadingParameter, residualNorm, iterator + 1, negativePivots);
+            if (passed) {
+                if (criticalPointTolerance > 0) localizeCriticalPoint(start, stepSize, tolerance, maxIterations, true);
+                reportCriticalPoint();
+            }
+            return false;
+        }
+    }
+    logger.logPoint(displacement, loadingParameter, residualNorm, maxIterations, -1);
+    return true;
+}
+
+Eigen::VectorXd Structure::multiplyMass(const Eigen::VectorXd &x) const {
+    Eigen::VectorXd y = Eigen::VectorXd::Zero(degreesOfFreedom);
+    forEachElement(elements, [&](const auto &element) {
+        const auto &map = degreeOfFreedomMap[element.index];
+        scatterElement(y, map, element.calculateMass(massType) * gatherElement(x, map));
+    });
+    return y;
+}
+
+double Structure::dynamicLoadingParameter(double load, double rampTime, double atTime) const {
+    if (atTime >= rampTime) return load;
+    return startLoadingParameter + (load - startLoadingParameter) * atTime / rampTime;
+}
+
+/*
+ * One implicit time step with the HHT-alpha method, where equilibrium is
+ *   M a_n+1 + (1 + alpha) (f_int - f_ext)_n+1 - alpha (f_int - f_ext)_n = 0
+ * and the displacement and velocity follow from the accelerations as in the Newmark method.
+ * The time integration starts at rest from the current state, which should be an equilibrium point.
+ * The effective tangent (1 + alpha) K_T + M / (beta dt^2) is only factorized again when the iterations converge
+ * slowly or the time step has changed, otherwise the factorization of an earlier iteration or step is reused.
+ * The time step is halved when a step does not converge, shrinks when it needs more than half of maxIterations
+ * and grows again while steps need at most a quarter of them.
+ * Returns whether the step failed at the smallest time step
+ */
+bool Structure::timeStep(const DynamicsSettings &settings, double tolerance, int maxIterations) {
+    if (!hasMass) throw std::runtime_error("Dynamics needs a density");
+    if (currentTimeStep == 0) {
+        velocity = Eigen::VectorXd::Zero(degreesOfFreedom);
+        acceleration = Eigen::VectorXd::Zero(degreesOfFreedom);
+        time = 0;
+        currentTimeStep = settings.timeStep;
+        startLoadingParameter = loadingParameter;
+        massType = settings.massType;
+    }
+    ++increment;
+    const StructureState start = getState();
+    int iterations = 0;
+    double residualNorm = 0;
+    while (dynamicIterations(settings, tolerance, maxIterations, iterations, residualNorm)) {
+        setState(start);
+        if (currentTimeStep / 2 < settings.minTimeStep) {
+            stiffnessFactor = 1;
+            massFactor = 0;
+            logger.logPoint(displacement, loadingParameter, residualNorm, maxIterations, -1);
+            return true;
+        }
+        currentTimeStep /= 2;
+        std::cout << "Time step reduced to " << currentTimeStep << " at time " << time << std::endl;
+    }
+    time += currentTimeStep;
+    // The static tangent is used outside the time integration, the factorization is kept for the next step
+    stiffnessFactor = 1;
+    massFactor = 0;
+    logger.logPoint(displacement, loadingParameter, residualNorm, iterations, -1);
+    logger.logTimeStep(time, displacement, loadingParameter);
+    if (iterations <= maxIterations / 4) currentTimeStep = std::min(currentTimeStep * 1.25, settings.maxTimeStep);
+    else if (iterations > maxIterations / 2) currentTimeStep = std::max(currentTimeStep * 0.7, settings.minTimeStep);
+    return false;
+}
+
+/*
+ * settings.steps time steps of the central difference method with the lumped mass:
+ *   v_n+1/2 = v_n-1/2 + dt M^-1 (f_ext - f_int)_n,  u_n+1 = u_n + dt v_n+1/2
+ * No tangent is needed, the inner forces come from the element arrays.
+ * The time step is a fraction of the critical time step estimated when the integration is started,
+ * which starts at rest from the current state.
+ * The structure is only updated and logged after the last step.
+ * Returns whether the integration became unstable
+ */
+bool Structure::explicitSteps(const ExplicitSettings &settings) {
+    if (!hasMass) throw std::runtime_error("Dynamics needs a density");
+    if (!elementArrays) {
+        elementArrays = std::make_unique<ElementArrays>(
+                vertices, connectivity, properties, nominalGlobalLoad, nominalLocalLoad,
+                findConstrainedDegreesOfFreedom(boundaryConditions, degreesOfFreedom));
+        explicitTimeStep = settings.timeStepFactor * elementArrays->criticalTimeStep();
+        velocity = Eigen::VectorXd::Zero(degreesOfFreedom);
+        time = 0;
+        startLoadingParameter = loadingParameter;
+        std::cout << "Explicit time step " << explicitTimeStep << ", critical time step "
+                  << elementArrays->criticalTimeStep() << std::endl;
+    }
+    ++increment;
+    const double dt = explicitTimeStep;
+    const Eigen::VectorXd inverseMass =
+            elementArrays->getLumpedMass().cwiseInverse().cwiseProduct(elementArrays->getFreeDegreesOfFreedom());
+    const double damping = settings.damping * dt / 2;
+    Eigen::VectorXd residual = Eigen::VectorXd::Zero(degreesOfFreedom);
+    for (unsigned int step = 0; step < settings.steps; ++step) {
+        elementArrays->calculateResidual(
+                displacement, dynamicLoadingParameter(settings.load, settings.rampTime, time), residual);
+        velocity = ((1 - damping) * velocity + dt * inverseMass.cwiseProduct(residual)) / (1 + damping);
+        displacement += dt * velocity;
+        time += dt;
+    }
+    loadingParameter = dynamicLoadingParameter(settings.load, settings.rampTime, time);
+    const bool unstable = !displacement.allFinite();
+    if (!unstable) update();
+    logger.logPoint(displacement, loadingParameter, residual.norm(), settings.steps, -1);
+    logger.logTimeStep(time, displacement, loadingParameter);
+    return unstable;
+}
+
+/*
+ * One load increment where the equilibrium is found by dynamic relaxation instead of Newton iterations:
+ * the structure is integrated in pseudo time with the central difference method, a unit time step
+ * and fictitious masses until the motion has died out.
+ * Only inner forces are needed, no tangent is assembled or factorized. The masses are half the Gershgorin
+ * bound of the element tangents at the start of the increment, twice the smallest stable ones.
+ * The motion is damped either kinetically, by stopping at every peak of the kinetic energy,
+ * or viscously, by default with the critical damping of the mode that is currently relaxing.
+ * Converged is the same residual norm as in the Newton iterations. Critical points are not detected,
+ * since that needs the inertia of the tangent.
+ * Returns whether it did not converge within maxSteps
+ */
+bool Structure::relax(const RelaxationSettings &settings, double stepSize, double tolerance) {
+    if (!elementArrays) {
+        elementArrays = std::make_unique<ElementArrays>(
+                vertices, connectivity, properties, nominalGlobalLoad, nominalLocalLoad,
+                findConstrainedDegreesOfFreedom(boundaryConditions, degreesOfFreedom));
+    }
+    ++increment;
+    loadingParameter += stepSize;
+
+    Eigen::VectorXd mass = Eigen::VectorXd::Zero(degreesOfFreedom);
+    forEachElement(elements, [&](const auto &element) {
+        scatterElement(mass, degreeOfFreedomMap[element.index],
+                       element.calculateTotalStiffness().cwiseAbs().rowwise().sum() / 2);
+    });
+    const Eigen::VectorXd inverseMass = mass.cwiseInverse().cwiseProduct(elementArrays->getFreeDegreesOfFreedom());
+
+    Eigen::VectorXd relaxationVelocity = Eigen::VectorXd::Zero(degreesOfFreedom);
+    Eigen::VectorXd residual(degreesOfFreedom);
+    Eigen::VectorXd lastResidual(degreesOfFreedom);
+    elementArrays->calculateResidual(displacement, loadingParameter, residual);
+    double kineticEnergy = 0;
+    double damping = settings.viscousDamping;
+    double residualNorm = residual.norm();
+    unsigned int step = 0;
+    for (; step < settings.maxSteps && residualNorm >= tolerance && std::isfinite(residualNorm); ++step) {
+        if (settings.damping == RelaxationDamping::KINETIC) {
+            Eigen::VectorXd nextVelocity = relaxationVelocity + inverseMass.cwiseProduct(residual);
+            const double nextKineticEnergy = nextVelocity.dot(mass.cwiseProduct(nextVelocity));
+            if (nextKineticEnergy < kineticEnergy) {
+                // The peak was half a step ago
+                displacement -= relaxationVelocity / 2;
+                relaxationVelocity.setZero();
+                kineticEnergy = 0;
+            } else {
+                relaxationVelocity = nextVelocity;
+                kineticEnergy = nextKineticEnergy;
+                displacement += relaxationVelocity;
+            }
+        } else {
+            relaxationVelocity = ((1 - damping / 2) * relaxationVelocity + inverseMass.cwiseProduct(residual)) /
+                                 (1 + damping / 2);
+            displacement += relaxationVelocity;
+        }
+        lastResidual.swap(residual);
+        elementArrays->calculateResidual(displacement, loadingParameter, residual);
+        residualNorm = residual.norm();
+
+        if (settings.damping == RelaxationDamping::VISCOUS && settings.viscousDamping == 0) {
+            // Rayleigh quotient of the last step, the stiffness along it over its mass
+            const double stiffness = -relaxationVelocity.dot(residual - lastResidual);
+            const double stepMass = relaxationVelocity.dot(mass.cwiseProduct(relaxationVelocity));
+            if (stepMass > 0) damping = std::min(2 * std::sqrt(std::max(stiffness / stepMass, 0.0)), 1.9);
+        }
+    }
+    if (residualNorm >= tolerance || !std::isfinite(residualNorm)) {
+        logger.logPoint(displacement, loadingParameter, residualNorm, step, -1);
+        return true;
+    }
+    update();
+    logger.logPoint(displacement, loadingParameter, residualNorm, step, -1);
+    return false;
+}
+
+/*
+ * Newton iterations of a time step, updates the state of the structure when they converge.
+ * Returns whether they did not converge
+ */
+bool Structure::dynamicIterations(const DynamicsSettings &settings, double tolerance, int maxIterations,
+                                  int &iterations, double &residualNorm) {
+    const double dt = currentTimeStep;
+    const double alpha = settings.alpha;
+    const double beta = (1 - alpha) * (1 - alpha) / 4;
+    const double gamma = (1 - 2 * alpha) / 2;
+    stiffnessFactor = 1 + alpha;
+    massFactor = 1 / (beta * dt * dt);
+
+    update();
+    const Eigen::VectorXd lastDisplacement = displacement;
+    const Eigen::VectorXd lastResidual = getNominalLoad() * loadingParameter - innerForces;
+    const double nextLoadingParameter = dynamicLoadingParameter(settings.load, settings.rampTime, time + dt);
+
+    displacement += dt * velocity + dt * dt * (0.5 - beta) * acceleration;
+    double lastResidualNorm = 0;
+    for (iterations = 0; iterations < maxIterations; ++iterations) {
+        update();
+        Eigen::VectorXd nextAcceleration = (displacement - lastDisplacement - dt * velocity) / (beta * dt * dt) -
+                                           (1 - 2 * beta) / (2 * beta) * acceleration;
+        Eigen::VectorXd residual = (1 + alpha) * (getNominalLoad() * nextLoadingParameter - innerForces) -
+                                   alpha * lastResidual - multiplyMass(nextAcceleration);
+        for (unsigned long long int i = 0; i < degreesOfFreedom; ++i) {
+            if (tangent.isConstrained(i)) residual(i) = 0;
+        }
+        residualNorm = residual.norm();
+        if (!std::isfinite(residualNorm)) return true;
+        if (residualNorm < tolerance) {
+            velocity += dt * ((1 - gamma) * acceleration + gamma * nextAcceleration);
+            acceleration = nextAcceleration;
+            loadingParameter = nextLoadingParameter;
             return false;
         }
+        // Modified Newton, the tangent is only factorized again when the convergence is slow
+        if (factorizedMassFactor != massFactor || (iterations > 0 && residualNorm > 0.5 * lastResidualNorm))
+            factorize();
+        lastResidualNorm = residualNorm;
+
+        Eigen::VectorXd deltaDisplacement = linearSolver->solve(residual);
+        logger.logCorrection(displacement, nextLoadingParameter, deltaDisplacement, 0);
+        displacement += deltaDisplacement;
     }
-    logger.logPoint(displacement, loadingParameter);
     return true;
 }
 
+/*
+ * Leaves a bifurcation point onto the secondary branch.
+ * The secondary branch is tangent to the buckling mode at the bifurcation point,
+ * so the predictor is a step of stepSize along the mode at constant load, which is then corrected as usual.
+ * Continue on the branch with arcLength, the predictor direction is kept from this step.
+ */
+bool Structure::switchBranch(const CriticalPointResult &point, double stepSize, double tolerance, int maxIterations) {
+    if (point.type != CriticalPoint::BIFURCATION || point.mode.size() == 0)
+        throw std::runtime_error("Branch switching needs a localized bifurcation point");
+    setState(point.state);
+    ++increment;
+    Eigen::VectorXd w_q0 = solve(getNominalLoad());
+    firstIteration = false;
+    // The inertia is not comparable between the two branches
+    negativePivots = -1;
+
+    lastDeltaDisplacement = point.mode.normalized() * stepSize;
+
+    logger.logPrediction(displacement, loadingParameter, lastDeltaDisplacement, 0);
+
+    displacement += lastDeltaDisplacement;
+
+    return arcLengthIterations(stepSize, tolerance, maxIterations, w_q0, point.state);
+}
+
+/*
+ * Solves (K_M + lambda K_G) phi = 0 for the lowest critical loads lambda of the undeformed structure.
+ * K_G is the geometric stiffness of the linear solution for the nominal load. It is taken from a tiny multiple
+ * of that solution and scaled back, which is exact in the limit since the geometric stiffness is linear
+ * in the inner forces.
+ * The eigenvalues 1/lambda of K_M^-1 (-K_G) are found with Lanczos in the K_M inner product,
+ * which only needs the factorization of K_M.
+ * The state of the structure is left unchanged.
+ */
+BucklingAnalysis Structure::linearBuckling(unsigned int modeCount) {
+    const StructureState current = getState();
+    StructureState undeformed = current;
+    undeformed.displacement.setZero();
+    undeformed.elementDisplacement.setZero();
+    undeformed.previousElementDisplacement.setZero();
+    setState(undeformed);
+
+    Tangent materialStiffness(degreesOfFreedom, findConstrainedDegreesOfFreedom(boundaryConditions, degreesOfFreedom));
+    forEachElement(elements, [&](const auto &element) {
+        materialStiffness.addElement(degreeOfFreedomMap[element.index]);
+        materialStiffness.setElementStiffness(materialStiffness.elementCount() - 1,
+                                              element.calculateMaterialStiffness());
+    });
+    materialStiffness.setOrdering(eliminationPositions);
+    linearSolver->factorize(materialStiffness);
+    // The linear solver no longer holds the tangent
+    tangentChanged = true;
+    const Eigen::VectorXd linearDisplacement = linearSolver->solve(getNominalLoad());
+
+    const double size = Eigen::Map<const Eigen::VectorXd>(vertices.data(), vertices.size()).cwiseAbs().maxCoeff();
+    const double scale = 1e-8 * size / linearDisplacement.cwiseAbs().maxCoeff();
+    displacement = scale * linearDisplacement;
+    update();
+    Tangent stressStiffness(degreesOfFreedom, findConstrainedDegreesOfFreedom(boundaryConditions, degreesOfFreedom));
+    forEachElement(elements, [&](const auto &element) {
+        stressStiffness.addElement(degreeOfFreedomMap[element.index]);
+        stressStiffness.setElementStiffness(stressStiffness.elementCount() - 1,
+                                            -element.calculateGeometricStiffness() / scale);
+    });
+
+    auto pairs = lanczos(
+            [&](const Eigen::VectorXd &x) {
+                Eigen::VectorXd y = stressStiffness.apply(x);
+                for (unsigned long long int i = 0; i < degreesOfFreedom; ++i) {
+                    if (stressStiffness.isConstrained(i)) y(i) = 0;
+                }
+                return linearSolver->solve(y);
+            },
+            [&](const Eigen::VectorXd &x) { return materialStiffness.apply(x); },
+            createStartVector(), modeCount
+    );
+    setState(current);
+
+    BucklingAnalysis analysis{};
+    int positive = 0;
+    while (positive < pairs.values.size() && pairs.values(positive) > 0) ++positive;
+    if (positive == 0) throw std::runtime_error("The structure does not buckle under the nominal load");
+    analysis.criticalLoads = pairs.values.head(positive).cwiseInverse();
+    analysis.modes = pairs.vectors.leftCols(positive);
+    for (int i = 0; i < positive; ++i) {
+        Eigen::VectorXd mode = analysis.modes.col(i);
+        normalizeMode(mode);
+        analysis.modes.col(i) = mode;
+    }
+    return analysis;
+}
+
+/*
+ * Solves K phi = omega^2 M phi with the tangent stiffness of the current state for the lowest frequencies.
+ * Shift-invert Lanczos on K^-1 M in the M inner product, so only the factorization of the tangent is needed.
+ * Modes with a negative omega^2 past a critical point are not found.
+ * The state of the structure is left unchanged.
+ */
+ModalAnalysis Structure::modalAnalysis(unsigned int modeCount, MassType massType) {
+    if (!hasMass) throw std::runtime_error("Modal analysis needs a density");
+    const StructureState current = getState();
+    // The tangent of the current displacement, the continuation keeps the one of the last iteration
+    update();
+    factorize();
+
+    Tangent mass(degreesOfFreedom, findConstrainedDegreesOfFreedom(boundaryConditions, degreesOfFreedom));
+    forEachElement(elements, [&](const auto &element) {
+        mass.addElement(degreeOfFreedomMap[element.index]);
+        mass.setElementStiffness(mass.elementCount() - 1, element.calculateMass(massType));
+    });
+    const auto applyMass = [&](const Eigen::VectorXd &x) {
+        Eigen::VectorXd y = mass.apply(x);
+        for (unsigned long long int i = 0; i < degreesOfFreedom; ++i) {
+            if (mass.isConstrained(i)) y(i) = 0;
+        }
+        return y;
+    };
+    auto pairs = lanczos(
+            [&](const Eigen::VectorXd &x) { return linearSolver->solve(applyMass(x)); },
+            applyMass, createStartVector(), modeCount
+    );
+    setState(current);
+
+    ModalAnalysis analysis{};
+    int positive = 0;
+    while (positive < pairs.values.size() && pairs.values(positive) > 0) ++positive;
+    // theta = 1 / omega^2
+    analysis.frequencies = pairs.values.head(positive).cwiseInverse().cwiseSqrt() / (2 * M_PI);
+    analysis.modes = pairs.vectors.leftCols(positive);
+    for (int i = 0; i < positive; ++i) {
+        Eigen::VectorXd mode = analysis.modes.col(i);
+        normalizeMode(mode);
+        analysis.modes.col(i) = mode;
+    }
+    return analysis;
+}
+
+ContinuationTuning Structure::tuneContinuation(unsigned int incrementsToCritical) {
+    const auto analysis = linearBuckling(1);
+    tuning = ContinuationTuning{};
+    tuning.loadScaling = analysis.criticalLoads(0);
+    nominalGlobalLoad *= tuning.loadScaling;
+    nominalLocalLoad *= tuning.loadScaling;
+    // The first arc length predictor is w_q0 / sqrt(1 + w_q0^2) times the arc length
+    factorize();
+    const Eigen::VectorXd w_q0 = linearSolver->solve(getNominalLoad());
+    tuning.loadStep = 1.0 / incrementsToCritical;
+    tuning.arcLength = std::sqrt(1.0 + w_q0.squaredNorm()) * tuning.loadStep;
+    std::cout << "Linear buckling load: " << tuning.loadScaling << " times the nominal load, arc length "
+              << tuning.arcLength << std::endl;
+    return tuning;
+}
+
 Eigen::VectorXd Structure::calculateInnerForces() {
     Eigen::VectorXd innerForces = Eigen::VectorXd::Zero(degreesOfFreedom);
-    for (auto &element : elements) {
-        const auto i = element.index * 3;
-        innerForces.block<6, 1>(i, 0) += element.calculateInnerForces();
-    }
+    forEachElement(elements, [&](auto &element) {
+        scatterElement(innerForces, degreeOfFreedomMap[element.index], element.calculateInnerForces());
+    });
     for (auto boundaryCondition : boundaryConditions) {
         auto degreeOfFreedom = boundaryCondition.globalDegreeOfFreedom < 0 ?
                                degreesOfFreedom + boundaryCondition.globalDegreeOfFreedom :
@@ -145,10 +712,171 @@ Eigen::VectorXd Structure::calculateInnerForces() {
 }
 
 void Structure::update() {
-    for (auto &element : elements) {
-        element.updateDeformation(displacement.block<6, 1>(element.index * 3, 0));
-    }
-    globalStiffness = calculateGlobalStiffnessMatrix();
+    previousElementDisplacement = elementDisplacement;
+    elementDisplacement = displacement;
+    forEachElement(elements, [&](auto &element) {
+        element.updateDeformation(gatherElement(displacement, degreeOfFreedomMap[element.index]));
+    });
+    forEachElement(elements, [&](const auto &element) {
+        if (massFactor == 0) {
+            tangent.setElementStiffness(element.index, element.calculateTotalStiffness());
+        } else {
+            tangent.setElementStiffness(element.index, stiffnessFactor * element.calculateTotalStiffness() +
+                                                       massFactor * element.calculateMass(massType));
+        }
+    });
+    tangentChanged = true;
     innerForces = calculateInnerForces();
 }
 
+/*
+ * Brings a transferred state back into equilibrium and finds the inertia of the tangent there.
+ * arclength: lets the loading parameter move as in the corrector of the arc length method, which still finds the
+ * path when the new mesh has its limit point below the current loading parameter; Newton iterations keep it fixed
+ * Returns whether the iterations did not converge
+ */
+bool Structure::restoreEquilibrium(double tolerance, int maxIterations, bool arclength) {
+    for (int iteration = 0;; ++iteration) {
+        const Eigen::VectorXd residual = getNominalLoad() * loadingParameter - innerForces;
+        if (residual.norm() < tolerance) break;
+        if (iteration == maxIterations) return true;
+        Eigen::VectorXd correction = solve(residual);
+        if (arclength) {
+            const Eigen::VectorXd w_q = solve(getNominalLoad());
+            const double dLambda = -w_q.dot(correction) / (1 + w_q.squaredNorm());
+            correction += dLambda * w_q;
+            loadingParameter += dLambda;
+        }
+        displacement += correction;
+        update();
+    }
+    factorize();
+    negativePivots = linearSolver->negativePivots();
+    return false;
+}
+
+/*
+ * The nodes an adaptation has to keep: those with loads or boundary conditions, the logged node,
+ * and every node that is not between exactly two elements, like the ends of a chain or the joints of a frame
+ */
+std::vector<bool> Structure::findPinnedNodes() const {
+    const size_t nodeCount = vertices.size() / 2;
+    std::vector<unsigned int> elementCounts(nodeCount, 0);
+    for (const auto &nodes : connectivity) {
+        ++elementCounts[nodes.first];
+        ++elementCounts[nodes.second];
+    }
+    std::vector<bool> pinned(nodeCount, false);
+    for (size_t node = 0; node < nodeCount; ++node) {
+        pinned[node] = elementCounts[node] != 2 ||
+                       nominalGlobalLoad.segment<3>(3 * node).any() || nominalLocalLoad.segment<3>(3 * node).any();
+    }
+    const auto constrained = findConstrainedDegreesOfFreedom(boundaryConditions, degreesOfFreedom);
+    for (size_t degreeOfFreedom = 0; degreeOfFreedom < degreesOfFreedom; ++degreeOfFreedom) {
+        if (constrained[degreeOfFreedom]) pinned[degreeOfFreedom / 3] = true;
+    }
+    pinned[logger.getLoggedNode()] = true;
+    return pinned;
+}
+
+std::unique_ptr<Structure> Structure::adapt(const AdaptivitySettings &settings, double tolerance, int maxIterations,
+                                            bool arclength, bool &diverging) {
+    diverging = false;
+    if (velocity.size() > 0)
+        throw std::runtime_error("The mesh can only be adapted between the increments of a static continuation");
+    std::vector<Eigen::Matrix<double, 6, 1>> elementForces;
+    elementForces.reserve(connectivity.size());
+    forEachElement(elements, [&](const auto &element) {
+        elementForces.push_back(element.getLocalInnerForces());
+    });
+    const auto indicators = calculateRefinementIndicators(connectivity, displacement, elementForces, settings);
+    const auto adapted = adaptMesh(vertices, connectivity, indicators, findPinnedNodes(), settings);
+    if (adapted.splitCount == 0 && adapted.mergeCount == 0) return nullptr;
+
+    // Loads and boundary conditions only act on pinned nodes, which keep their degrees of freedom
+    auto adaptedDegreeOfFreedom = [&adapted](unsigned long long int degreeOfFreedom) {
+        return 3 * adapted.newNodes[degreeOfFreedom / 3] + static_cast<int>(degreeOfFreedom % 3);
+    };
+    std::vector<BoundaryCondition> adaptedBoundaryConditions;
+    for (auto boundaryCondition : boundaryConditions) {
+        auto degreeOfFreedom = boundaryCondition.globalDegreeOfFreedom < 0 ?
+                               degreesOfFreedom + boundaryCondition.globalDegreeOfFreedom :
+                               boundaryCondition.globalDegreeOfFreedom;
+        adaptedBoundaryConditions.push_back(
+                BoundaryCondition{adaptedDegreeOfFreedom(degreeOfFreedom), boundaryCondition.value});
+    }
+    // The nominal loads already hold the load scaling of the tuning
+    std::vector<Force> forces;
+    for (unsigned long long int i = 0; i < degreesOfFreedom; ++i) {
+        const int node = adapted.newNodes[i / 3];
+        const auto degreeOfFreedom = static_cast<int>(i % 3);
+        if (nominalGlobalLoad(i) != 0)
+            forces.push_back(Force{ForceType::GLOBAL, node, degreeOfFreedom, nominalGlobalLoad(i)});
+        if (nominalLocalLoad(i) != 0)
+            forces.push_back(Force{ForceType::LOCAL, node, degreeOfFreedom, nominalLocalLoad(i)});
+    }
+    // The arc length is measured in all degrees of freedom, so the tuned one is scaled to keep the load step
+    const double predictorLength = std::sqrt(1.0 + solve(getNominalLoad()).squaredNorm());
+
+    logger.startMesh(mesh + 1, adapted.newNodes[logger.getLoggedNode()]);
+    auto structure = std::make_unique<Structure>(
+            adapted.vertices, adapted.connectivity, properties, adaptedBoundaryConditions, forces,
+            std::move(logger), std::move(linearSolver), ordering);
+    structure->mesh = mesh + 1;
+    structure->tuning = tuning;
+    structure->criticalPointTolerance = criticalPointTolerance;
+    // The last step is transferred as the difference of its two ends, so it follows the rotations as well
+    const Eigen::VectorXd transferred = transferDisplacement(adapted, vertices, connectivity, displacement);
+    const Eigen::VectorXd transferredStart = transferDisplacement(adapted, vertices, connectivity,
+                                                                  displacement - lastDeltaDisplacement);
+    structure->setState(StructureState{
+            transferred, transferred, transferred, transferred - transferredStart,
+            loadingParameter, firstIteration, increment, negativePivots
+    });
+    diverging = structure->restoreEquilibrium(tolerance, maxIterations, arclength);
+    if (diverging) return structure;
+    if (tuning.arcLength > 0) {
+        structure->tuning.arcLength *=
+                std::sqrt(1.0 + structure->solve(structure->getNominalLoad()).squaredNorm()) / predictorLength;
+    }
+    std::cout << "Mesh " << structure->mesh << ": split " << adapted.splitCount << " and merged "
+              << adapted.mergeCount << " elements, " << connectivity.size() << " -> "
+              << structure->connectivity.size() << " elements, negative pivots " << negativePivots << " -> "
+              << structure->negativePivots << std::endl;
+    return structure;
+}
+
+StructureState Structure::getState() const {
+    return StructureState{
+            displacement, elementDisplacement, previousElementDisplacement, lastDeltaDisplacement,
+            loadingParameter, firstIteration, increment, negativePivots
+    };
+}
+
+void Structure::setState(const StructureState &state) {
+    if (static_cast<unsigned long long int>(state.displacement.size()) != degreesOfFreedom)
+        throw std::runtime_error("State does not match the degrees of freedom of the structure");
+    // Replays the last two element updates to get the same element states and tangent stiffness
+    displacement = state.previousElementDisplacement;
+    update();
+    displacement = state.elementDisplacement;
+    update();
+    displacement = state.displacement;
+    lastDeltaDisplacement = state.lastDeltaDisplacement;
+    loadingParameter = state.loadingParameter;
+    firstIteration = state.firstIteration;
+    increment = state.increment;
+    negativePivots = state.negativePivots;
+}
+
+void Structure::saveCheckpoint(const std::string &filename) const {
+    writeCheckpoint(filename, getState(), logger.getPositions());
+}
+
+void Structure::restoreCheckpoint(const std::string &filename, bool restoreLogs) {
+    StructureState state;
+    LoggerPositions positions{};
+    readCheckpoint(filename, state, positions);
+    setState(state);
+    if (restoreLogs) logger.truncate(positions);
+}
@@ -7,8 +7,16 @@
 #include <Eigen/Dense>
 #include <iostream>
 #include <memory>
+#include "adaptivity.hpp"
 #include "BeamElement.hpp"
+#include "checkpoint.hpp"
+#include "connectivity.hpp"
+#include "elementArrays.hpp"
+#include "elementTypes.hpp"
+#include "linearSolver.hpp"
 #include "logger.hpp"
+#include "ordering.hpp"
+#include "tangent.hpp"
 
 struct BoundaryCondition {
     int globalDegreeOfFreedom;
@@ -19,6 +27,106 @@ enum class ForceType {
     GLOBAL, LOCAL
 };
 
+enum class CriticalPoint {
+    NONE, LIMIT, BIFURCATION
+};
+
+/*
+ * A critical point passed by the continuation
+ * loadingParameter, displacement: the converged point after it, or the localized critical point
+ * mode: the buckling mode normalized to a largest translation of 1, empty if not localized or if the
+ *       localization did not converge
+ * state: the state just after the localized critical point, empty without a mode
+ */
+struct CriticalPointResult {
+    CriticalPoint type = CriticalPoint::NONE;
+    double loadingParameter = 0;
+    int negativePivots = 0;
+    Eigen::VectorXd displacement;
+    Eigen::VectorXd mode;
+    StructureState state;
+};
+
+/*
+ * Linear buckling of the undeformed structure
+ * criticalLoads: loading parameters of the lowest buckling modes in ascending order
+ * modes: the buckling modes as columns, normalized to a largest translation of 1
+ */
+struct BucklingAnalysis {
+    Eigen::VectorXd criticalLoads;
+    Eigen::MatrixXd modes;
+};
+
+/*
+ * Natural vibrations around the current state
+ * frequencies: the lowest natural frequencies in ascending order, in cycles per time unit
+ * modes: the mode shapes as columns, normalized to a largest translation of 1
+ */
+struct ModalAnalysis {
+    Eigen::VectorXd frequencies;
+    Eigen::MatrixXd modes;
+};
+
+/*
+ * Continuation settings chosen from the linear buckling load
+ * loadScaling: factor the nominal loads were scaled with, so a loading parameter of 1 is the buckling load
+ * arcLength, loadStep: step sizes for arcLength and newton
+ */
+struct ContinuationTuning {
+    double loadScaling = 1;
+    double arcLength = 0;
+    double loadStep = 0;
+};
+
+/*
+ * Settings of the implicit time integration, see Structure::timeStep
+ * timeStep: the first time step, it is adapted between minTimeStep and maxTimeStep
+ * alpha: numerical damping of the HHT-alpha method in [-1/3, 0], 0 is the average acceleration Newmark method
+ * load, rampTime: the loading parameter goes linearly from its value at the start to load in rampTime
+ */
+struct DynamicsSettings {
+    double timeStep;
+    double minTimeStep;
+    double maxTimeStep;
+    double alpha;
+    double load;
+    double rampTime;
+    MassType massType;
+};
+
+/*
+ * Settings of the explicit time integration, see Structure::explicitSteps
+ * timeStepFactor: fraction of the critical time step that is used
+ * load, rampTime: the loading parameter goes linearly from its value at the start to load in rampTime
+ * steps: time steps per increment, the state is only logged and shown after every increment
+ * damping: mass proportional damping coefficient
+ */
+struct ExplicitSettings {
+    double timeStepFactor;
+    double load;
+    double rampTime;
+    unsigned int steps;
+    double damping;
+};
+
+enum class RelaxationDamping {
+    // The velocities are reset at every peak of the kinetic energy
+    KINETIC,
+    // Mass proportional damping
+    VISCOUS
+};
+
+/*
+ * Settings of the dynamic relaxation, see Structure::relax
+ * viscousDamping: damping coefficient for the unit time step, 0 estimates the critical damping while relaxing
+ * maxSteps: relaxation steps per increment before it counts as diverged
+ */
+struct RelaxationSettings {
+    RelaxationDamping damping;
+    double viscousDamping;
+    unsigned int maxSteps;
+};
+
 struct Force {
     ForceType forceType;
     int node;
@@ -28,60 +136,150 @@ struct Force {
 
 class Structure {
     std::vector<double> vertices;
-    Eigen::MatrixXd globalStiffness;
+    const std::vector<ElementNodes> connectivity;
+    // The global degrees of freedom of every element
+    const std::vector<ElementDegreesOfFreedom> degreeOfFreedomMap;
+    // Position of every degree of freedom in the elimination order of the sparse factorizations
+    std::vector<unsigned int> eliminationPositions;
+    const Ordering ordering;
+    // Number of the mesh, counts the adaptations since the structure was loaded
+    unsigned int mesh = 0;
 
     bool firstIteration = true;
+    unsigned int increment = 0;
+    // Negative pivots of the tangent at the last converged point, -1 if unknown
+    int negativePivots = 0;
+    // The critical point passed in the last increment
+    CriticalPointResult lastCriticalPoint;
+    // Relative arc length to which critical points are localized, 0 disables the localization
+    double criticalPointTolerance = 0;
+    // Set while probing steps for the localization
+    bool localizing = false;
+    ContinuationTuning tuning;
+    const ElementProperties properties;
+    // Whether the elements were given a density, which modal analysis and dynamics need
+    const bool hasMass;
+
+    // Time integration, the time step is 0 until it is started
+    Eigen::VectorXd velocity;
+    Eigen::VectorXd acceleration;
+    double time = 0;
+    double currentTimeStep = 0;
+    double startLoadingParameter = 0;
+    // The tangent holds stiffnessFactor * K_T + massFactor * M, the effective tangent of the time integration
+    double stiffnessFactor = 1;
+    double massFactor = 0;
+    MassType massType = MassType::LUMPED;
+    // massFactor of the tangent the linear solver has factorized
+    double factorizedMassFactor = 0;
+    // Explicit time integration and dynamic relaxation, created when they are started
+    std::unique_ptr<ElementArrays> elementArrays;
+    double explicitTimeStep = 0;
     Logger logger;
     const unsigned long long int degreesOfFreedom;
     Eigen::VectorXd nominalLocalLoad;
     Eigen::VectorXd nominalGlobalLoad;
 
     Eigen::VectorXd displacement;
+    // The displacements of the last two element updates, see StructureState
+    Eigen::VectorXd elementDisplacement;
+    Eigen::VectorXd previousElementDisplacement;
     Eigen::VectorXd lastDeltaDisplacement;
     Eigen::VectorXd innerForces;
 
-    std::vector<BeamElement> elements{};
+    ElementVector elements{};
     double loadingParameter = 0;
     const std::vector<BoundaryCondition> boundaryConditions;
 
-    Eigen::MatrixXd applyBoundaryConditions(Eigen::MatrixXd &stiffness) const;
+    Tangent tangent;
+    // Whether the tangent changed since the linear solver last saw it
+    bool tangentChanged = true;
+    std::unique_ptr<LinearSolver> linearSolver;
+
+    static std::vector<bool> findConstrainedDegreesOfFreedom(
+            const std::vector<BoundaryCondition> &boundaryConditions, unsigned long long int degreesOfFreedom);
 
     Eigen::VectorXd getNominalLoad();
 
-    bool newtonIterations(double tolerance, int maxIterations);
+    void orderDegreesOfFreedom(Ordering ordering);
+
+    void factorize();
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b);
+
+    bool detectCriticalPoint(const Eigen::VectorXd &direction, const Eigen::VectorXd &lastDirection);
+
+    void localizeCriticalPoint(const StructureState &start, double stepSize, double tolerance, int maxIterations,
+                               bool arclength);
+
+    Eigen::VectorXd createStartVector() const;
+
+    static void normalizeMode(Eigen::VectorXd &mode);
+
+    Eigen::VectorXd calculateCriticalMode();
+
+    void reportCriticalPoint();
+
+    bool newtonIterations(double tolerance, int maxIterations, const Eigen::VectorXd &lastDirection);
+
+    Eigen::VectorXd multiplyMass(const Eigen::VectorXd &x) const;
+
+    double dynamicLoadingParameter(double load, double rampTime, double atTime) const;
+
+    bool dynamicIterations(const DynamicsSettings &settings, double tolerance, int maxIterations,
+                           int &iterations, double &residualNorm);
+
+    bool arcLengthIterations(double stepSize, double tolerance, int maxIterations,
+                             const Eigen::VectorXd &w_q0, const StructureState &start);
 
     Eigen::VectorXd calculateInnerForces();
 
     void update();
 
-    Eigen::MatrixXd calculateGlobalStiffnessMatrix() const;
+    bool restoreEquilibrium(double tolerance, int maxIterations, bool arclength);
+
+    std::vector<bool> findPinnedNodes() const;
 
 public:
-    explicit Structure(
+    /*
+     * A frame of beam elements between the given vertices
+     * connectivity: the nodes of every element, indices into the vertices
+     * ordering: elimination order of the sparse factorizations, chosen once here
+     */
+    Structure(
             std::vector<double> vertices,
+            std::vector<ElementNodes> connectivity,
             ElementProperties properties,
             std::vector<BoundaryCondition> boundaryConditions,
             const std::vector<Force> &forces,
-            Logger logger
+            Logger logger,
+            std::unique_ptr<LinearSolver> linearSolver = std::make_unique<DirectSolver>(),
+            Ordering ordering = Ordering::REVERSE_CUTHILL_MCKEE
     ) :
             vertices(vertices),
+            connectivity(std::move(connectivity)),
+            degreeOfFreedomMap(mapDegreesOfFreedom(this->connectivity)),
+            ordering(ordering),
+            properties(properties),
+            hasMass(properties.density > 0),
             degreesOfFreedom((vertices.size() * 3) / 2),
             displacement(Eigen::VectorXd::Zero(degreesOfFreedom)),
+            elementDisplacement(Eigen::VectorXd::Zero(degreesOfFreedom)),
             nominalLocalLoad(Eigen::VectorXd::Zero(degreesOfFreedom)),
             nominalGlobalLoad(Eigen::VectorXd::Zero(degreesOfFreedom)),
             boundaryConditions(std::move(boundaryConditions)),
             lastDeltaDisplacement(Eigen::VectorXd::Zero(degreesOfFreedom)),
             innerForces(Eigen::VectorXd::Zero(degreesOfFreedom)),
+            tangent(degreesOfFreedom, findConstrainedDegreesOfFreedom(this->boundaryConditions, degreesOfFreedom)),
+            linearSolver(std::move(linearSolver)),
             logger(std::move(logger)) {
-        elements.reserve(vertices.size() / 2);
-        for (int i = 0; i < vertices.size() - 2; i += 2) {
-            elements.push_back(BeamElement{
-                    Eigen::Vector2d{vertices[i], vertices[i + 1]},
-                    Eigen::Vector2d{vertices[i + 2], vertices[i + 3]},
-                    properties,
-                    static_cast<unsigned int>(i / 2)
-            });
+        validateConnectivity(this->connectivity, this->vertices.size() / 2);
+        elements = createElements(this->vertices, this->connectivity, properties);
+        for (const auto &map : degreeOfFreedomMap) {
+            tangent.addElement(map);
         }
+        orderDegreesOfFreedom(ordering);
+        this->logger.logStructure(this->vertices, this->connectivity, degreesOfFreedom);
         update();
         for (auto force : forces) {
             if (force.forceType == ForceType::GLOBAL)
@@ -91,12 +289,84 @@ public:
         }
     }
 
+    // A chain of beam elements, every vertex connected with the next one
+    explicit Structure(
+            std::vector<double> vertices,
+            ElementProperties properties,
+            std::vector<BoundaryCondition> boundaryConditions,
+            const std::vector<Force> &forces,
+            Logger logger,
+            std::unique_ptr<LinearSolver> linearSolver = std::make_unique<DirectSolver>()
+    ) :
+            Structure(vertices, chainConnectivity(vertices.size() / 2), properties, std::move(boundaryConditions),
+                      forces, std::move(logger), std::move(linearSolver)) {}
+
     std::vector<double> getVertices();
 
+    const std::vector<ElementNodes> &getConnectivity() const { return connectivity; }
+
+    unsigned int getMesh() const { return mesh; }
+
     bool newton(double stepSize, double tolerance, int maxIterations);
 
     bool arcLength(double stepSize, double tolerance, int maxIterations);
 
+    bool timeStep(const DynamicsSettings &settings, double tolerance, int maxIterations);
+
+    bool explicitSteps(const ExplicitSettings &settings);
+
+    bool relax(const RelaxationSettings &settings, double stepSize, double tolerance);
+
+    double getTime() const { return time; }
+
+    bool switchBranch(const CriticalPointResult &point, double stepSize, double tolerance, int maxIterations);
+
+    BucklingAnalysis linearBuckling(unsigned int modeCount);
+
+    ModalAnalysis modalAnalysis(unsigned int modeCount, MassType massType);
+
+    /*
+     * Scales the loads to the linear buckling load and chooses step sizes that reach it in incrementsToCritical
+     * increments, has to be called before the first increment
+     */
+    ContinuationTuning tuneContinuation(unsigned int incrementsToCritical);
+
+    // The step sizes of tuneContinuation, zero if it was not called
+    const ContinuationTuning &getTuning() const { return tuning; }
+
+    unsigned int getIncrement() const { return increment; }
+
+    double getLoadingParameter() const { return loadingParameter; }
+
+    int getNegativePivots() const { return negativePivots; }
+
+    const CriticalPointResult &getLastCriticalPoint() const { return lastCriticalPoint; }
+
+    void setCriticalPointTolerance(double tolerance) { criticalPointTolerance = tolerance; }
+
+    /*
+     * Refines and coarsens the mesh by the change of rotation and bending moment over every element, see adaptMesh,
+     * between increments of a static continuation.
+     * Returns a structure on the adapted mesh that continues from the transferred state with the logs and the
+     * linear solver of this one, which is unusable afterwards; nullptr if the mesh stays the same.
+     * arclength: whether the loading parameter may move while the equilibrium is restored, see restoreEquilibrium
+     * diverging: set if the transferred state could not be brought back into equilibrium
+     */
+    std::unique_ptr<Structure> adapt(const AdaptivitySettings &settings, double tolerance, int maxIterations,
+                                     bool arclength, bool &diverging);
+
+    StructureState getState() const;
+
+    void setState(const StructureState &state);
+
+    void saveCheckpoint(const std::string &filename) const;
+
+    /*
+     * Continues from a saved checkpoint.
+     * restoreLogs: cut the log files back to the checkpoint, disable when forking a new run from it
+     */
+    void restoreCheckpoint(const std::string &filename, bool restoreLogs = true);
+
 };
 
 
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <numeric>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "substructuringSolver.hpp"
+
+/*
+ * Splits the elements into subdomains of consecutive elements in the elimination order,
+ * which are slabs of the structure for the reverse Cuthill-McKee order
+ */
+void SubstructuringSolver::findSubdomains(const Tangent &newTangent) {
+    const auto elementCount = newTangent.elementCount();
+    size_t count = requestedSubdomains;
+#ifdef _OPENMP
+    if (count == 0) count = static_cast<size_t>(omp_get_max_threads());
+#endif
+    count = std::max<size_t>(1, std::min(count, elementCount));
+
+    const auto firstPosition = [&](size_t element) {
+        const auto &map = newTangent.elementMap(element);
+        return std::min(newTangent.position(map[0]), newTangent.position(map[3]));
+    };
+    std::vector<unsigned int> elements(elementCount);
+    std::iota(elements.begin(), elements.end(), 0);
+    std::stable_sort(elements.begin(), elements.end(), [&](unsigned int first, unsigned int second) {
+        return firstPosition(first) < firstPosition(second);
+    });
+    // The factorizations can not be moved, so the subdomains are created in place
+    subdomains = std::vector<Subdomain>(count);
+    for (size_t s = 0; s < count; ++s) {
+        subdomains[s].elements.assign(elements.begin() + s * elementCount / count,
+                                      elements.begin() + (s + 1) * elementCount / count);
+    }
+
+    // The subdomain of every free degree of freedom, -1 if it has none and -2 if it is shared
+    std::vector<int> owner(newTangent.size(), -1);
+    for (size_t s = 0; s < count; ++s) {
+        for (auto element : subdomains[s].elements) {
+            for (auto dof : newTangent.elementMap(element)) {
+                if (newTangent.isConstrained(dof)) continue;
+                if (owner[dof] == -1) owner[dof] = static_cast<int>(s);
+                else if (owner[dof] != static_cast<int>(s)) owner[dof] = -2;
+            }
+        }
+    }
+    const auto byPosition = [&](unsigned int first, unsigned int second) {
+        return newTangent.position(first) < newTangent.position(second);
+    };
+    interface.clear();
+    for (unsigned int dof = 0; dof < newTangent.size(); ++dof) {
+        if (owner[dof] == -2) interface.push_back(dof);
+        else if (owner[dof] >= 0) subdomains[owner[dof]].interior.push_back(dof);
+    }
+    std::sort(interface.begin(), interface.end(), byPosition);
+    std::vector<int> interfaceIndex(newTangent.size(), -1);
+    for (size_t i = 0; i < interface.size(); ++i) interfaceIndex[interface[i]] = static_cast<int>(i);
+    interfaceValues.resize(static_cast<Eigen::Index>(interface.size()));
+
+    // Local numbering of every subdomain, the interior in elimination order to keep the fill small
+    std::vector<int> localIndex(newTangent.size(), 0);
+    for (auto &subdomain : subdomains) {
+        std::sort(subdomain.interior.begin(), subdomain.interior.end(), byPosition);
+        for (size_t i = 0; i < subdomain.interior.size(); ++i) localIndex[subdomain.interior[i]] = static_cast<int>(i);
+        for (auto element : subdomain.elements) {
+            for (auto dof : newTangent.elementMap(element)) {
+                if (owner[dof] == -2) subdomain.boundary.push_back(dof);
+            }
+        }
+        std::sort(subdomain.boundary.begin(), subdomain.boundary.end(), byPosition);
+        subdomain.boundary.erase(std::unique(subdomain.boundary.begin(), subdomain.boundary.end()),
+                                 subdomain.boundary.end());
+        for (size_t i = 0; i < subdomain.boundary.size(); ++i) {
+            localIndex[subdomain.boundary[i]] = -1 - static_cast<int>(i);
+            subdomain.interfaceIndex.push_back(static_cast<unsigned int>(interfaceIndex[subdomain.boundary[i]]));
+        }
+        for (auto element : subdomain.elements) {
+            std::array<int, 6> indices{};
+            const auto &map = newTangent.elementMap(element);
+            for (int i = 0; i < 6; ++i) indices[i] = localIndex[map[i]];
+            subdomain.localIndices.push_back(indices);
+        }
+        subdomain.stiffnesses.resize(subdomain.elements.size());
+        subdomain.interiorValues.resize(static_cast<Eigen::Index>(subdomain.interior.size()));
+        subdomain.boundaryValues.resize(static_cast<Eigen::Index>(subdomain.boundary.size()));
+    }
+}
+
+/*
+ * Factorizes the interior of a subdomain and condenses it onto the boundary, returns false if a pivot vanished
+ */
+bool SubstructuringSolver::condense(Subdomain &subdomain, const Tangent &newTangent) {
+    const auto interiorSize = static_cast<Eigen::Index>(subdomain.interior.size());
+    const auto boundarySize = static_cast<Eigen::Index>(subdomain.boundary.size());
+    std::vector<Eigen::Triplet<double>> interiorTriplets, couplingTriplets;
+    subdomain.condensed = Eigen::MatrixXd::Zero(boundarySize, boundarySize);
+    for (size_t k = 0; k < subdomain.elements.size(); ++k) {
+        const auto element = subdomain.elements[k];
+        const auto &map = newTangent.elementMap(element);
+        const auto &indices = subdomain.localIndices[k];
+        const auto &stiffness = newTangent.elementStiffness(element);
+        subdomain.stiffnesses[k] = stiffness;
+        for (int column = 0; column < 6; ++column) {
+            if (newTangent.isConstrained(map[column])) continue;
+            for (int row = 0; row < 6; ++row) {
+                if (newTangent.isConstrained(map[row])) continue;
+                const int rowIndex = indices[row], columnIndex = indices[column];
+                if (rowIndex >= 0 && columnIndex >= 0) {
+                    interiorTriplets.emplace_back(rowIndex, columnIndex, stiffness(row, column));
+                } else if (rowIndex >= 0) {
+                    couplingTriplets.emplace_back(rowIndex, -1 - columnIndex, stiffness(row, column));
+                } else if (columnIndex < 0) {
+                    subdomain.condensed(-1 - rowIndex, -1 - columnIndex) += stiffness(row, column);
+                }
+            }
+        }
+    }
+    Eigen::SparseMatrix<double> interiorMatrix(interiorSize, interiorSize);
+    interiorMatrix.setFromTriplets(interiorTriplets.begin(), interiorTriplets.end());
+    subdomain.coupling.resize(interiorSize, boundarySize);
+    subdomain.coupling.setFromTriplets(couplingTriplets.begin(), couplingTriplets.end());
+
+    subdomain.factorization.compute(interiorMatrix);
+    if (subdomain.factorization.info() != Eigen::Success) return false;
+    subdomain.negativePivots = static_cast<int>((subdomain.factorization.vectorD().array() < 0).count());
+    if (boundarySize > 0 && interiorSize > 0) {
+        const Eigen::MatrixXd coupling = subdomain.coupling;
+        subdomain.condensed -= subdomain.coupling.transpose() * subdomain.factorization.solve(coupling);
+    }
+    return true;
+}
+
+void SubstructuringSolver::factorize(const Tangent &newTangent) {
+    if (&newTangent != tangent || subdomains.empty()) findSubdomains(newTangent);
+    tangent = &newTangent;
+
+    const auto count = static_cast<long>(subdomains.size());
+    bool condensed = true;
+    unsigned int condensedSubdomains = 0;
+#pragma omp parallel for schedule(dynamic) reduction(&&:condensed) reduction(+:condensedSubdomains)
+    for (long s = 0; s < count; ++s) {
+        auto &subdomain = subdomains[s];
+        bool changed = !subdomain.upToDate;
+        for (size_t k = 0; k < subdomain.elements.size() && !changed; ++k) {
+            changed = subdomain.stiffnesses[k] != newTangent.elementStiffness(subdomain.elements[k]);
+        }
+        if (!changed) continue;
+        subdomain.upToDate = condense(subdomain, newTangent);
+        condensed = condensed && subdomain.upToDate;
+        ++condensedSubdomains;
+    }
+    condensedCount = condensedSubdomains;
+
+    useFallback = !condensed;
+    if (!useFallback) {
+        // Each subdomain only couples its own boundary, so the interface system stays sparse
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (const auto &subdomain : subdomains) {
+            for (size_t column = 0; column < subdomain.boundary.size(); ++column) {
+                for (size_t row = 0; row < subdomain.boundary.size(); ++row) {
+                    triplets.emplace_back(subdomain.interfaceIndex[row], subdomain.interfaceIndex[column],
+                                          subdomain.condensed(row, column));
+                }
+            }
+        }
+        const auto interfaceSize = static_cast<Eigen::Index>(interface.size());
+        Eigen::SparseMatrix<double> interfaceMatrix(interfaceSize, interfaceSize);
+        interfaceMatrix.setFromTriplets(triplets.begin(), triplets.end());
+        interfaceFactorization.compute(interfaceMatrix);
+        useFallback = interfaceFactorization.info() != Eigen::Success;
+    }
+    if (useFallback) fallback.factorize(newTangent);
+}
+
+Eigen::VectorXd SubstructuringSolver::solve(const Eigen::VectorXd &b) {
+    if (useFallback) return fallback.solve(b);
+    // Constrained degrees of freedom have a one on the diagonal
+    Eigen::VectorXd x = b;
+
+    // The interiors with fixed boundaries, whose reactions load the interface
+    const auto count = static_cast<long>(subdomains.size());
+#pragma omp parallel for schedule(dynamic)
+    for (long s = 0; s < count; ++s) {
+        auto &subdomain = subdomains[s];
+        for (size_t i = 0; i < subdomain.interior.size(); ++i) subdomain.interiorValues(i) = b(subdomain.interior[i]);
+        subdomain.interiorValues = subdomain.factorization.solve(subdomain.interiorValues);
+        subdomain.boundaryValues = subdomain.coupling.transpose() * subdomain.interiorValues;
+    }
+    for (size_t i = 0; i < interface.size(); ++i) interfaceValues(i) = b(interface[i]);
+    for (const auto &subdomain : subdomains) {
+        for (size_t i = 0; i < subdomain.boundary.size(); ++i) {
+            interfaceValues(subdomain.interfaceIndex[i]) -= subdomain.boundaryValues(i);
+        }
+    }
+    interfaceValues = interfaceFactorization.solve(interfaceValues);
+    for (size_t i = 0; i < interface.size(); ++i) x(interface[i]) = interfaceValues(i);
+
+    // And the interiors again with the displacement of their boundaries
+#pragma omp parallel for schedule(dynamic)
+    for (long s = 0; s < count; ++s) {
+        auto &subdomain = subdomains[s];
+        for (size_t i = 0; i < subdomain.boundary.size(); ++i) {
+            subdomain.boundaryValues(i) = interfaceValues(subdomain.interfaceIndex[i]);
+        }
+        for (size_t i = 0; i < subdomain.interior.size(); ++i) subdomain.interiorValues(i) = b(subdomain.interior[i]);
+        subdomain.interiorValues -= subdomain.coupling * subdomain.boundaryValues;
+        subdomain.interiorValues = subdomain.factorization.solve(subdomain.interiorValues);
+        for (size_t i = 0; i < subdomain.interior.size(); ++i) x(subdomain.interior[i]) = subdomain.interiorValues(i);
+    }
+    return x;
+}
+
+int SubstructuringSolver::negativePivots() const {
+    if (useFallback) return fallback.negativePivots();
+    int count = static_cast<int>((interfaceFactorization.vectorD().array() < 0).count());
+    for (const auto &subdomain : subdomains) count += subdomain.negativePivots;
+    return count;
+}
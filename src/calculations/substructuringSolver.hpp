@@ -0,0 +1,72 @@
+#ifndef SFEMS_SUBSTRUCTURINGSOLVER_HPP
+#define SFEMS_SUBSTRUCTURINGSOLVER_HPP
+
+#include <array>
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "linearSolver.hpp"
+
+/*
+ * Domain decomposition by substructuring: the elements are split into subdomains along the elimination order,
+ * every subdomain condenses its interior degrees of freedom onto the boundary it shares with other subdomains,
+ * and the assembled interface system (the Schur complement) is solved for the displacement of the boundaries.
+ * The condensation and the interior solves run in parallel over the subdomains on the OpenMP threads.
+ * A subdomain whose element stiffnesses did not change since the last factorization keeps its condensation.
+ * The inertia is the one of the interiors plus the one of the interface system (Haynsworth).
+ * Falls back to the SparseDirectSolver when a pivot vanishes.
+ */
+class SubstructuringSolver : public LinearSolver {
+    struct Subdomain {
+        std::vector<unsigned int> elements;
+        // Degrees of freedom coupled by no other subdomain, in elimination order, and those on the interface
+        std::vector<unsigned int> interior, boundary;
+        // Index of every boundary degree of freedom in the interface system
+        std::vector<unsigned int> interfaceIndex;
+        // Local index of every degree of freedom of every element, interior as i and boundary as -1 - i
+        std::vector<std::array<int, 6>> localIndices;
+        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::NaturalOrdering<int>> factorization;
+        // K_IB
+        Eigen::SparseMatrix<double> coupling;
+        // K_BB - K_BI K_II^-1 K_IB
+        Eigen::MatrixXd condensed;
+        // The element stiffnesses of the last condensation
+        std::vector<Eigen::Matrix<double, 6, 6>> stiffnesses;
+        bool upToDate = false;
+        int negativePivots = 0;
+        // Work vectors of the solves
+        Eigen::VectorXd interiorValues, boundaryValues;
+    };
+
+    // Subdomains to split the elements into, 0 for one per OpenMP thread
+    const unsigned int requestedSubdomains;
+    std::vector<Subdomain> subdomains;
+    // The degrees of freedom shared by several subdomains, in elimination order
+    std::vector<unsigned int> interface;
+    // The interface system is ordered by minimum degree, which keeps the inertia
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> interfaceFactorization;
+    Eigen::VectorXd interfaceValues;
+    unsigned int condensedCount = 0;
+
+    const Tangent *tangent = nullptr;
+    bool useFallback = false;
+    SparseDirectSolver fallback;
+
+    void findSubdomains(const Tangent &tangent);
+
+    bool condense(Subdomain &subdomain, const Tangent &tangent);
+
+public:
+    explicit SubstructuringSolver(unsigned int subdomains = 0) : requestedSubdomains(subdomains) {}
+
+    void factorize(const Tangent &tangent) override;
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &b) override;
+
+    int negativePivots() const override;
+
+    // Subdomains condensed again in the last factorization, the others were reused
+    unsigned int condensedSubdomains() const { return condensedCount; }
+};
+
+#endif //SFEMS_SUBSTRUCTURINGSOLVER_HPP
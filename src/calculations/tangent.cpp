@@ -0,0 +1,95 @@
+#include "tangent.hpp"
+
+void Tangent::addElement(const ElementDegreesOfFreedom &map) {
+    elementMaps.push_back(map);
+    elementStiffnesses.emplace_back(Eigen::Matrix<double, 6, 6>::Zero());
+}
+
+Eigen::VectorXd Tangent::apply(const Eigen::VectorXd &x) const {
+    Eigen::VectorXd free = x;
+    for (size_t i = 0; i < degreesOfFreedom; ++i) {
+        if (constrained[i]) free(i) = 0;
+    }
+    Eigen::VectorXd y = Eigen::VectorXd::Zero(degreesOfFreedom);
+    for (size_t element = 0; element < elementMaps.size(); ++element) {
+        const auto &map = elementMaps[element];
+        scatterElement(y, map, elementStiffnesses[element] * gatherElement(free, map));
+    }
+    for (size_t i = 0; i < degreesOfFreedom; ++i) {
+        if (constrained[i]) y(i) = x(i);
+    }
+    return y;
+}
+
+Eigen::MatrixXd Tangent::assemble() const {
+    Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(degreesOfFreedom, degreesOfFreedom);
+    for (size_t element = 0; element < elementMaps.size(); ++element) {
+        const auto &map = elementMaps[element];
+        for (int column = 0; column < 6; ++column) {
+            for (int row = 0; row < 6; ++row) {
+                matrix(map[row], map[column]) += elementStiffnesses[element](row, column);
+            }
+        }
+    }
+    for (size_t i = 0; i < degreesOfFreedom; ++i) {
+        if (!constrained[i]) continue;
+        matrix.row(i).setZero();
+        matrix.col(i).setZero();
+        matrix(i, i) = 1;
+    }
+    return matrix;
+}
+
+Eigen::SparseMatrix<double> Tangent::assembleSparse() const {
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(36 * elementMaps.size() + degreesOfFreedom);
+    for (size_t element = 0; element < elementMaps.size(); ++element) {
+        const auto &map = elementMaps[element];
+        for (int column = 0; column < 6; ++column) {
+            if (constrained[map[column]]) continue;
+            for (int row = 0; row < 6; ++row) {
+                if (constrained[map[row]]) continue;
+                triplets.emplace_back(position(map[row]), position(map[column]),
+                                      elementStiffnesses[element](row, column));
+            }
+        }
+    }
+    for (size_t i = 0; i < degreesOfFreedom; ++i) {
+        if (constrained[i]) triplets.emplace_back(position(i), position(i), 1);
+    }
+    Eigen::SparseMatrix<double> matrix(degreesOfFreedom, degreesOfFreedom);
+    // Duplicates are summed, which adds up the element contributions
+    matrix.setFromTriplets(triplets.begin(), triplets.end());
+    return matrix;
+}
+
+Eigen::VectorXd Tangent::toEliminationOrder(const Eigen::VectorXd &x) const {
+    if (positions.empty()) return x;
+    Eigen::VectorXd ordered(x.size());
+    for (size_t i = 0; i < degreesOfFreedom; ++i) ordered(positions[i]) = x(i);
+    return ordered;
+}
+
+Eigen::VectorXd Tangent::fromEliminationOrder(const Eigen::VectorXd &x) const {
+    if (positions.empty()) return x;
+    Eigen::VectorXd original(x.size());
+    for (size_t i = 0; i < degreesOfFreedom; ++i) original(i) = x(positions[i]);
+    return original;
+}
+
+std::vector<Eigen::Matrix3d> Tangent::nodalDiagonalBlocks() const {
+    std::vector<Eigen::Matrix3d> blocks(degreesOfFreedom / 3, Eigen::Matrix3d::Zero());
+    for (size_t element = 0; element < elementMaps.size(); ++element) {
+        const auto &map = elementMaps[element];
+        blocks[map[0] / 3] += elementStiffnesses[element].topLeftCorner<3, 3>();
+        blocks[map[3] / 3] += elementStiffnesses[element].bottomRightCorner<3, 3>();
+    }
+    for (size_t i = 0; i < degreesOfFreedom; ++i) {
+        if (!constrained[i]) continue;
+        auto &block = blocks[i / 3];
+        block.row(i % 3).setZero();
+        block.col(i % 3).setZero();
+        block(i % 3, i % 3) = 1;
+    }
+    return blocks;
+}
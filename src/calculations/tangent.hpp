@@ -0,0 +1,70 @@
+#ifndef SFEMS_TANGENT_HPP
+#define SFEMS_TANGENT_HPP
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "connectivity.hpp"
+
+/*
+ * The tangent stiffness of a structure, kept as the 6x6 stiffness of every element
+ * instead of an assembled global matrix.
+ * Every element has a map to its global degrees of freedom, so it can belong to any frame.
+ * Constrained degrees of freedom get a zero row and column with a one on the diagonal.
+ */
+class Tangent {
+    const unsigned long long int degreesOfFreedom;
+    std::vector<ElementDegreesOfFreedom> elementMaps;
+    std::vector<Eigen::Matrix<double, 6, 6>> elementStiffnesses;
+    const std::vector<bool> constrained;
+    // Position of every degree of freedom in the elimination order of the sparse factorizations, empty if natural
+    std::vector<unsigned int> positions;
+
+public:
+    Tangent(unsigned long long int degreesOfFreedom, std::vector<bool> constrained) :
+            degreesOfFreedom(degreesOfFreedom),
+            constrained(std::move(constrained)) {}
+
+    void addElement(const ElementDegreesOfFreedom &map);
+
+    void setOrdering(std::vector<unsigned int> degreeOfFreedomPositions) {
+        positions = std::move(degreeOfFreedomPositions);
+    }
+
+    void setElementStiffness(size_t element, const Eigen::Matrix<double, 6, 6> &stiffness) {
+        elementStiffnesses[element] = stiffness;
+    }
+
+    unsigned long long int size() const { return degreesOfFreedom; }
+
+    size_t elementCount() const { return elementMaps.size(); }
+
+    const ElementDegreesOfFreedom &elementMap(size_t element) const { return elementMaps[element]; }
+
+    const Eigen::Matrix<double, 6, 6> &elementStiffness(size_t element) const { return elementStiffnesses[element]; }
+
+    bool isConstrained(size_t degreeOfFreedom) const { return constrained[degreeOfFreedom]; }
+
+    // Position of a degree of freedom in the elimination order
+    size_t position(size_t degreeOfFreedom) const {
+        return positions.empty() ? degreeOfFreedom : positions[degreeOfFreedom];
+    }
+
+    // Multiplies the tangent with a vector without assembling it
+    Eigen::VectorXd apply(const Eigen::VectorXd &x) const;
+
+    Eigen::MatrixXd assemble() const;
+
+    // Assembles only the nonzeros, which for a frame grow linearly with its size, in the elimination order
+    Eigen::SparseMatrix<double> assembleSparse() const;
+
+    // Permutes a vector into the elimination order of assembleSparse
+    Eigen::VectorXd toEliminationOrder(const Eigen::VectorXd &x) const;
+
+    Eigen::VectorXd fromEliminationOrder(const Eigen::VectorXd &x) const;
+
+    // The 3x3 diagonal block of every node
+    std::vector<Eigen::Matrix3d> nodalDiagonalBlocks() const;
+};
+
+#endif //SFEMS_TANGENT_HPP
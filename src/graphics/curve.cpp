@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <vector>
 #include "curve.hpp"
 #include "shaderUtils.hpp"
@@ -9,10 +11,29 @@
 #define TOTAL_GRAPH_WIDTH 1.99f
 #define MAIN_GRAPH_HEIGHT (0.5f)
 
+// Amount of segments in the vertex ring buffer, lets the cpu write one while the gpu draws another
+#define RING_SEGMENT_COUNT 3
+
+// Location of the uniform scaling the coordinates to the view in the vertex shader
+#define SCALE_UNIFORM_LOCATION 3
+
 // OpenGL identifiers
 GLuint curveShaderProgram;
 GLuint curveVertexArray;
-GLuint curveVertexBuffer;
+GLuint curveVertexBuffer = 0;
+GLuint curveElementBuffer = 0;
+
+// Persistently mapped vertex buffer, split into RING_SEGMENT_COUNT segments
+GLdouble *mappedVertices = nullptr;
+// Without OpenGL 4.4 there is no buffer storage: the segments are written here and uploaded by curve_commit
+bool persistentMapping = false;
+std::vector<GLdouble> stagingVertices;
+size_t segmentCapacity = 0; // coordinates per segment
+GLsync segmentFences[RING_SEGMENT_COUNT] = {};
+int currentSegment = 0;
+size_t currentCoordinateCount = 0;
+// Vertex indices of the lines between connected vertices, 0 draws the vertices as one line strip
+GLsizei elementIndexCount = 0;
 
 /*
  * Various generation, binding, etc for Opengl
@@ -20,40 +41,129 @@ GLuint curveVertexBuffer;
 void curve_init() {
     curveShaderProgram = glCreateProgram();
     glGenVertexArrays(1, &curveVertexArray);
+}
+
+/*
+ * (Re)creates the persistently mapped vertex buffer with room for the given amount of coordinates per segment,
+ * or a plain buffer with a copy in memory where persistent mapping is not available
+ */
+void allocateRingBuffer(size_t coordinateCapacity) {
+    for (auto &fence : segmentFences) {
+        if (!fence) continue;
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (curveVertexBuffer) glDeleteBuffers(1, &curveVertexBuffer);
+
+    segmentCapacity = coordinateCapacity;
+    const auto size = static_cast<GLsizeiptr>(sizeof(GLdouble) * segmentCapacity * RING_SEGMENT_COUNT);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
     glBindVertexArray(curveVertexArray);
     glGenBuffers(1, &curveVertexBuffer);
     glBindBuffer(GL_ARRAY_BUFFER, curveVertexBuffer);
-    glVertexAttribPointer(0, VERTEX_COORDINATE_COUNT, GL_FLOAT, GL_FALSE, 0, nullptr);
+    persistentMapping = GLAD_GL_VERSION_4_4;
+    if (persistentMapping) {
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        mappedVertices = static_cast<GLdouble *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        stagingVertices.assign(segmentCapacity * RING_SEGMENT_COUNT, 0);
+        mappedVertices = stagingVertices.data();
+    }
+    // Doubles are passed straight to the shader, the segments are selected with the first vertex when drawing
+    glVertexAttribLPointer(0, VERTEX_COORDINATE_COUNT, GL_DOUBLE, 0, nullptr);
     glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
 }
 
 /*
- * Updates the graph with the new values
+ * Returns memory for the given amount of coordinates in the next ring segment,
+ * the values are shown after curve_commit is called
  */
-void curve_update(const std::vector<GLfloat> &vertices) {
-    glBindBuffer(GL_ARRAY_BUFFER, curveVertexBuffer);
+GLdouble *curve_map(size_t coordinateCount) {
+    if (coordinateCount > segmentCapacity) {
+        // Grow with some headroom so refined meshes do not reallocate every time
+        allocateRingBuffer(std::max(coordinateCount, segmentCapacity * 2));
+    }
+    const int nextSegment = (currentSegment + 1) % RING_SEGMENT_COUNT;
+    // Wait until the gpu is done drawing from the segment before overwriting it
+    auto &fence = segmentFences[nextSegment];
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    return mappedVertices + nextSegment * segmentCapacity;
+}
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size() * VERTEX_COORDINATE_COUNT, &vertices.front(),
-                 GL_DYNAMIC_DRAW);
+/*
+ * Shows the coordinates written to the memory returned by the last curve_map
+ */
+void curve_commit(size_t coordinateCount) {
+    currentSegment = (currentSegment + 1) % RING_SEGMENT_COUNT;
+    if (!persistentMapping) {
+        glBindBuffer(GL_ARRAY_BUFFER, curveVertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(sizeof(GLdouble) * currentSegment * segmentCapacity),
+                        static_cast<GLsizeiptr>(sizeof(GLdouble) * coordinateCount),
+                        mappedVertices + currentSegment * segmentCapacity);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    currentCoordinateCount = coordinateCount;
+}
+
+/*
+ * Sets which vertices are connected, as two vertex indices per line.
+ * They stay valid when the vertices are updated, so a frame only needs them once
+ */
+void curve_setElements(const std::vector<GLuint> &elementVertices) {
+    glBindVertexArray(curveVertexArray);
+    if (!curveElementBuffer) glGenBuffers(1, &curveElementBuffer);
+    // The element buffer binding is part of the vertex array state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, curveElementBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(GLuint) * elementVertices.size()),
+                 elementVertices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    elementIndexCount = static_cast<GLsizei>(elementVertices.size());
 }
 
 /*
- * Updates and draws the graph with the new values
+ * Updates the graph with the new values
+ */
+void curve_update(const std::vector<GLdouble> &vertices) {
+    std::memcpy(curve_map(vertices.size()), vertices.data(), sizeof(GLdouble) * vertices.size());
+    curve_commit(vertices.size());
+}
+
+/*
+ * Draws the graph with the values from the last update
+ * scale: factor from model coordinates to normalized device coordinates
  */
-void curve_draw(const std::vector<GLfloat> &vertices) {
-    curve_update(vertices);
+void curve_draw(float scale) {
+    // Nothing to draw before the first update
+    if (currentCoordinateCount == 0) return;
 
     glUseProgram(curveShaderProgram);
     glBindVertexArray(curveVertexArray);
+    glUniform1f(SCALE_UNIFORM_LOCATION, scale);
 
+    auto first = static_cast<GLint>(currentSegment * segmentCapacity / VERTEX_COORDINATE_COUNT);
+    auto vertices_count = static_cast<GLsizei>(currentCoordinateCount / VERTEX_COORDINATE_COUNT);
     // Sets the color to be the first of the colors defined in the shader
-    auto coordinates_count = static_cast<int>(vertices.size());
-    int vertices_count = coordinates_count / VERTEX_COORDINATE_COUNT;
     glUniform1i(2, 0);
-    glDrawArrays(GL_LINE_STRIP, 0, vertices_count);
+    if (elementIndexCount > 0)
+        glDrawElementsBaseVertex(GL_LINES, elementIndexCount, GL_UNSIGNED_INT, nullptr, first);
+    else
+        glDrawArrays(GL_LINE_STRIP, first, vertices_count);
     glUniform1i(2, 1);
     glPointSize(5);
-    glDrawArrays(GL_POINTS, 0, vertices_count);
+    glDrawArrays(GL_POINTS, first, vertices_count);
+
+    // Marks when the gpu is done reading the segment
+    auto &fence = segmentFences[currentSegment];
+    if (fence) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 /*
@@ -6,7 +6,15 @@
 
 void curve_init();
 
-void curve_draw(const std::vector<GLfloat> &vertices);
+GLdouble *curve_map(size_t coordinateCount);
+
+void curve_commit(size_t coordinateCount);
+
+void curve_setElements(const std::vector<GLuint> &elementVertices);
+
+void curve_update(const std::vector<GLdouble> &vertices);
+
+void curve_draw(float scale);
 
 void curve_reload();
 
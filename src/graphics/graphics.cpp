@@ -25,7 +25,30 @@ void graphics_init(void *(*loadProc)(const char)) {
 }
 
 
-void graphics_draw(const std::vector<GLfloat> &vertices) {
+/*
+ * Returns memory for writing the given amount of curve coordinates directly to the gpu,
+ * they are drawn after graphics_commitVertices is called
+ */
+double *graphics_mapVertices(size_t coordinateCount) {
+    return curve_map(coordinateCount);
+}
+
+void graphics_commitVertices(size_t coordinateCount) {
+    curve_commit(coordinateCount);
+}
+
+/*
+ * Sets which curve vertices are connected by lines, two vertex indices per line
+ */
+void graphics_setElements(const std::vector<unsigned int> &elementVertices) {
+    curve_setElements(elementVertices);
+}
+
+void graphics_updateVertices(const std::vector<double> &vertices) {
+    curve_update(vertices);
+}
+
+void graphics_draw(float scale) {
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
@@ -33,7 +56,7 @@ void graphics_draw(const std::vector<GLfloat> &vertices) {
     ui_draw();
 //    marker_draw(boatPosition, targetPosition);
 //    graph_draw(boatPosition, minorGraphValues);
-    curve_draw(vertices);
+    curve_draw(scale);
 
     // Unbind any bound vertex arrays to prevent bugs
     glBindVertexArray(0);
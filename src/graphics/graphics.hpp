@@ -1,12 +1,21 @@
 #ifndef TMR4160_GRAPHICS_H
 #define TMR4160_GRAPHICS_H
 
+#include <cstddef>
 #include <vector>
 
 void graphics_init(void *(*loadProc)(const char));
 
 void graphics_reload();
 
-void graphics_draw(const std::vector<float> &vertices);
+double *graphics_mapVertices(size_t coordinateCount);
+
+void graphics_commitVertices(size_t coordinateCount);
+
+void graphics_setElements(const std::vector<unsigned int> &elementVertices);
+
+void graphics_updateVertices(const std::vector<double> &vertices);
+
+void graphics_draw(float scale);
 
 #endif //TMR4160_GRAPHICS_H
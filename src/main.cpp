@@ -1,11 +1,20 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <yaml-cpp/yaml.h>
 #include "graphics/graphics.hpp"
 #include "utils/arch.hpp"
+#include "utils/frame.hpp"
 #include "utils/fileUtils.hpp"
 #include "calculations/BeamElement.hpp"
+#include "calculations/history.hpp"
+#include "calculations/krylovSolver.hpp"
+#include "calculations/skylineSolver.hpp"
+#include "calculations/blockTridiagonalSolver.hpp"
+#include "calculations/substructuringSolver.hpp"
 #include "calculations/logger.hpp"
+#include "calculations/solverWorker.hpp"
 #include "calculations/structure.hpp"
 
 extern "C" {
@@ -15,38 +24,121 @@ extern "C" {
 double initialViewWidth;
 double viewWidth;
 double increments;
-std::unique_ptr<Structure> structure;
+SolverSettings settings;
+std::unique_ptr<SolverWorker> solver;
+// Elements of the loaded structure, for drawing
+std::vector<ElementNodes> connectivity;
+// The adapted mesh whose elements are drawn, see SolverSnapshot
+unsigned int shownMesh = 0;
 
-int maxIterations;
-double tolerance;
+// Index of the mode shape that is animated, -1 shows the structure at rest
+int shownMode = -1;
 
-bool arclength;
+// Replay of a stored history instead of calculating, frame 0 is the undeformed structure
+std::string replayFilename;
+std::unique_ptr<HistoryReader> replay;
+size_t replayFrame = 0;
 
-double stepSize;
+/*
+ * Settings of the linear solver from the iterator section of config.yaml
+ */
+struct LinearSolverSettings {
+    // direct, sparse, skyline, chain, substructuring, mixed, cg or minres
+    std::string type = "direct";
+    // Relative residual and iteration limit of the iterative solvers
+    double tolerance = 1e-10;
+    unsigned int maxIterations = 0;
+    // Out of core storage of the skyline solver, in memory if the filename is empty
+    std::string scratchFilename;
+    size_t panelSize = 0;
+    // Of the substructuring solver, 0 for one per thread
+    unsigned int subdomains = 0;
+    // The arch for the multigrid preconditioner of cg, which uses block Jacobi if it is empty
+    std::vector<double> multigridVertices;
+};
 
-std::unique_ptr<Structure> loadStuff() {
+/*
+ * Creates the linear solver used for the tangent system
+ * scratchPrefix: prepended to the scratch file, so the solvers of several branches do not share it
+ */
+std::unique_ptr<LinearSolver> createLinearSolver(const LinearSolverSettings &settings,
+                                                 const std::string &scratchPrefix) {
+    const auto &type = settings.type;
+    if (type == "cg" || type == "minres") {
+        std::unique_ptr<MultigridPreconditioner> multigrid;
+        if (!settings.multigridVertices.empty())
+            multigrid = std::make_unique<MultigridPreconditioner>(settings.multigridVertices);
+        return std::make_unique<KrylovSolver>(type == "cg" ? KrylovMethod::CG : KrylovMethod::MINRES,
+                                              settings.tolerance, settings.maxIterations, std::move(multigrid));
+    }
+    if (type == "mixed")
+        return std::make_unique<MixedPrecisionSolver>();
+    if (type == "sparse")
+        return std::make_unique<SparseDirectSolver>();
+    if (type == "substructuring")
+        return std::make_unique<SubstructuringSolver>(settings.subdomains);
+    if (type == "chain")
+        return std::make_unique<BlockTridiagonalSolver>();
+    if (type == "skyline") {
+        const auto scratchFilename = settings.scratchFilename.empty() ? "" : scratchPrefix + settings.scratchFilename;
+        return std::make_unique<SkylineSolver>(scratchFilename, settings.panelSize);
+    }
+    return std::make_unique<DirectSolver>();
+}
+
+/*
+ * Loads the settings from config.yaml and returns a factory for the structure described there
+ * resume: append to the existing log files, used when restarting from a checkpoint
+ */
+StructureFactory loadStuff(bool resume = false) {
     YAML::Node config = YAML::LoadFile("config.yaml");
 
     auto curveConfig = config["curve"];
-    CurveExpression *expression;
-    if (curveConfig["type"].as<std::string>() == "arch") {
-        expression = new CircleExpression(
-                curveConfig["radius"].as<double>(),
-                curveConfig["height"].as<double>());
+    const auto elementCount = config["elementCount"].as<unsigned int>();
+    std::vector<double> vertices;
+    std::vector<ElementNodes> elementNodes;
+    if (curveConfig["type"].as<std::string>() == "frame") {
+        // Joints as [x, y] and members as [joint, joint], every member is divided into elementCount elements
+        std::vector<double> joints;
+        for (auto joint : curveConfig["joints"]) {
+            joints.push_back(joint[0].as<double>());
+            joints.push_back(joint[1].as<double>());
+        }
+        std::vector<ElementNodes> members;
+        for (auto member : curveConfig["members"]) {
+            members.push_back(ElementNodes{member[0].as<unsigned int>(), member[1].as<unsigned int>()});
+        }
+        auto frame = meshFrame(joints, members, elementCount);
+        vertices = std::move(frame.vertices);
+        elementNodes = std::move(frame.connectivity);
     } else {
-        expression = new LineExpression(
-                curveConfig["length"].as<double>(),
-                curveConfig["height"].as<double>());
+        CurveExpression *expression;
+        if (curveConfig["type"].as<std::string>() == "arch") {
+            expression = new CircleExpression(
+                    curveConfig["radius"].as<double>(),
+                    curveConfig["height"].as<double>());
+        } else {
+            expression = new LineExpression(
+                    curveConfig["length"].as<double>(),
+                    curveConfig["height"].as<double>());
+        }
+        vertices = calculateArch(elementCount, expression);
+        delete expression;
+        elementNodes = chainConnectivity(elementCount + 1);
     }
-    const auto elementCount = config["elementCount"].as<unsigned int>();
-    auto vertices = calculateArch(elementCount, expression);
-    delete expression;
+    connectivity = elementNodes;
+    // The middle node of a chain, of a frame it is just some node
+    const auto middleNode = static_cast<unsigned int>(vertices.size() / 2 - 1) / 2;
     auto properties = ElementProperties{
             config["youngsModulus"].as<double>(),
             config["crossSectionArea"].as<double>(),
             config["momentOfIntertia"].as<double>()
     };
-    int degreesOfFreedom = (elementCount + 1) * 3;
+    if (config["density"].IsDefined())
+        properties.density = config["density"].as<double>();
+    if (config["elementType"].IsDefined() && config["elementType"].as<std::string>() == "higherOrder")
+        properties.type = ElementType::HIGHER_ORDER;
+    int degreesOfFreedom = static_cast<int>(vertices.size() / 2) * 3;
     std::vector<BoundaryCondition> boundaryConditions{};
     for (auto boundaryCondition : config["boundaryConditions"]) {
         auto degreeOfFreedom = boundaryCondition["globalDegreeOfFreedom"].as<int>();
@@ -60,7 +152,7 @@ std::unique_ptr<Structure> loadStuff() {
     for (auto forceNode : config["force"]) {
         int node;
         if (forceNode["node"].as<std::string>() == "middle") {
-            node = elementCount / 2;
+            node = static_cast<int>(middleNode);
         } else {
             node = forceNode["node"].as<int>();
         }
@@ -80,29 +172,319 @@ std::unique_ptr<Structure> loadStuff() {
 
     unsigned int nodeToLog;
     if (config["logging"]["node"].as<std::string>() == "middle")
-        nodeToLog = elementCount / 2;
+        nodeToLog = middleNode;
     else
         nodeToLog = config["logging"]["node"].as<unsigned int>();
-    Logger logger = Logger(nodeToLog, config["logging"]["degreeOfFreedom"].as<unsigned int>());
+    std::string logPrefix;
+    if (config["logging"]["prefix"].IsDefined())
+        logPrefix = config["logging"]["prefix"].as<std::string>();
+    auto degreeOfFreedomToLog = config["logging"]["degreeOfFreedom"].as<unsigned int>();
 
     viewWidth = initialViewWidth = config["viewWidth"].as<double>();
     auto iteratorConfig = config["iterator"];
     increments = iteratorConfig["increments"].as<int>();
-    maxIterations = iteratorConfig["maxIterationsPerIncrement"].as<int>();
-    tolerance = iteratorConfig["tolerance"].as<double>();
-    arclength = !(iteratorConfig["type"].as<std::string>() == "newton");
-    if (iteratorConfig["stepSize"].IsDefined())
-        stepSize = iteratorConfig["stepSize"].as<double>();
+    settings.maxIterations = iteratorConfig["maxIterationsPerIncrement"].as<int>();
+    settings.tolerance = iteratorConfig["tolerance"].as<double>();
+    settings.arclength = !(iteratorConfig["type"].as<std::string>() == "newton" ||
+                           iteratorConfig["type"].as<std::string>() == "relaxation");
+    settings.dynamic = iteratorConfig["type"].as<std::string>() == "dynamic";
+    if (settings.dynamic) {
+        auto dynamicsConfig = config["dynamics"];
+        settings.dynamics.timeStep = dynamicsConfig["timeStep"].as<double>();
+        settings.dynamics.minTimeStep = settings.dynamics.timeStep / 1024;
+        if (dynamicsConfig["minTimeStep"].IsDefined())
+            settings.dynamics.minTimeStep = dynamicsConfig["minTimeStep"].as<double>();
+        settings.dynamics.maxTimeStep = settings.dynamics.timeStep * 16;
+        if (dynamicsConfig["maxTimeStep"].IsDefined())
+            settings.dynamics.maxTimeStep = dynamicsConfig["maxTimeStep"].as<double>();
+        settings.dynamics.alpha = 0;
+        if (dynamicsConfig["alpha"].IsDefined())
+            settings.dynamics.alpha = dynamicsConfig["alpha"].as<double>();
+        settings.dynamics.load = dynamicsConfig["load"].as<double>();
+        settings.dynamics.rampTime = 0;
+        if (dynamicsConfig["rampTime"].IsDefined())
+            settings.dynamics.rampTime = dynamicsConfig["rampTime"].as<double>();
+        settings.dynamics.massType = MassType::LUMPED;
+        if (dynamicsConfig["mass"].IsDefined() && dynamicsConfig["mass"].as<std::string>() == "consistent")
+            settings.dynamics.massType = MassType::CONSISTENT;
+    }
+    settings.explicitDynamic = iteratorConfig["type"].as<std::string>() == "explicit";
+    if (settings.explicitDynamic) {
+        // The vectorized element loop only has the linear element, see ElementArrays
+        if (properties.type != ElementType::LINEAR)
+            throw std::runtime_error("Explicit dynamics only has the linear element");
+        auto explicitConfig = config["explicit"];
+        settings.explicitDynamics.timeStepFactor = 0.9;
+        if (explicitConfig["timeStepFactor"].IsDefined())
+            settings.explicitDynamics.timeStepFactor = explicitConfig["timeStepFactor"].as<double>();
+        settings.explicitDynamics.load = explicitConfig["load"].as<double>();
+        settings.explicitDynamics.rampTime = 0;
+        if (explicitConfig["rampTime"].IsDefined())
+            settings.explicitDynamics.rampTime = explicitConfig["rampTime"].as<double>();
+        settings.explicitDynamics.steps = explicitConfig["stepsPerIncrement"].as<unsigned int>();
+        if (settings.explicitDynamics.steps == 0)
+            throw std::runtime_error("An explicit increment needs at least one step");
+        settings.explicitDynamics.damping = 0;
+        if (explicitConfig["damping"].IsDefined())
+            settings.explicitDynamics.damping = explicitConfig["damping"].as<double>();
+    }
+    settings.relaxation = iteratorConfig["type"].as<std::string>() == "relaxation";
+    if (settings.relaxation) {
+        // The vectorized element loop only has the linear element, see ElementArrays
+        if (properties.type != ElementType::LINEAR)
+            throw std::runtime_error("Dynamic relaxation only has the linear element");
+        auto relaxationConfig = config["relaxation"];
+        settings.relaxationSettings.damping = RelaxationDamping::KINETIC;
+        if (relaxationConfig["damping"].IsDefined() && relaxationConfig["damping"].as<std::string>() == "viscous")
+            settings.relaxationSettings.damping = RelaxationDamping::VISCOUS;
+        settings.relaxationSettings.viscousDamping = 0;
+        if (relaxationConfig["viscousDamping"].IsDefined())
+            settings.relaxationSettings.viscousDamping = relaxationConfig["viscousDamping"].as<double>();
+        settings.relaxationSettings.maxSteps = 100000;
+        if (relaxationConfig["maxSteps"].IsDefined())
+            settings.relaxationSettings.maxSteps = relaxationConfig["maxSteps"].as<unsigned int>();
+    }
+    // stepSize: auto chooses the step size from a linear buckling analysis and scales the loads to its critical load
+    unsigned int incrementsToCritical = 0;
+    if (iteratorConfig["stepSize"].IsDefined() && iteratorConfig["stepSize"].as<std::string>() == "auto") {
+        settings.stepSize = 0;
+        incrementsToCritical = 10;
+        if (iteratorConfig["incrementsToCritical"].IsDefined())
+            incrementsToCritical = iteratorConfig["incrementsToCritical"].as<unsigned int>();
+    } else if (iteratorConfig["stepSize"].IsDefined())
+        settings.stepSize = iteratorConfig["stepSize"].as<double>();
     else
-        stepSize = 1.0 / increments;
+        settings.stepSize = 1.0 / increments;
 
-    return std::make_unique<Structure>(vertices, properties, boundaryConditions, forceVector, std::move(logger));
+    LinearSolverSettings solverSettings;
+    if (iteratorConfig["solver"].IsDefined())
+        solverSettings.type = iteratorConfig["solver"].as<std::string>();
+    if (iteratorConfig["solverTolerance"].IsDefined())
+        solverSettings.tolerance = iteratorConfig["solverTolerance"].as<double>();
+    if (iteratorConfig["solverMaxIterations"].IsDefined())
+        solverSettings.maxIterations = iteratorConfig["solverMaxIterations"].as<unsigned int>();
+    // Elimination order of the sparse and skyline solvers: rcm, nestedDissection or natural
+    Ordering ordering = Ordering::REVERSE_CUTHILL_MCKEE;
+    if (iteratorConfig["ordering"].IsDefined()) {
+        const auto orderingType = iteratorConfig["ordering"].as<std::string>();
+        if (orderingType == "nestedDissection") ordering = Ordering::NESTED_DISSECTION;
+        else if (orderingType == "natural") ordering = Ordering::NATURAL;
+    }
+    // Keeps the skyline solver's factor in a scratch file, worked on in panels of panelMegabytes
+    if (iteratorConfig["outOfCore"].IsDefined()) {
+        solverSettings.scratchFilename = iteratorConfig["outOfCore"]["scratchFile"].as<std::string>();
+        double panelMegabytes = 256;
+        if (iteratorConfig["outOfCore"]["panelMegabytes"].IsDefined())
+            panelMegabytes = iteratorConfig["outOfCore"]["panelMegabytes"].as<double>();
+        solverSettings.panelSize = static_cast<size_t>(panelMegabytes * (1 << 20) / sizeof(double));
+    }
+    if (iteratorConfig["subdomains"].IsDefined())
+        solverSettings.subdomains = iteratorConfig["subdomains"].as<unsigned int>();
+    // Multigrid over the arch refined from elementCount down, for cg on arches
+    if (iteratorConfig["preconditioner"].IsDefined() &&
+        iteratorConfig["preconditioner"].as<std::string>() == "multigrid") {
+        // The V-cycle takes the signs of an indefinite tangent, minres needs a positive definite preconditioner
+        if (solverSettings.type != "cg")
+            throw std::runtime_error("The multigrid preconditioner is only for cg, minres uses block Jacobi");
+        solverSettings.multigridVertices = vertices;
+    }
+
+    settings.branchSwitching = iteratorConfig["branchSwitching"].IsDefined() &&
+                               iteratorConfig["branchSwitching"].as<bool>();
+    settings.branchIncrements = static_cast<unsigned int>(increments);
+    if (iteratorConfig["branchIncrements"].IsDefined())
+        settings.branchIncrements = iteratorConfig["branchIncrements"].as<unsigned int>();
+    settings.modeCount = 6;
+    if (config["modal"]["modeCount"].IsDefined())
+        settings.modeCount = config["modal"]["modeCount"].as<unsigned int>();
+    settings.massType = MassType::LUMPED;
+    if (config["modal"]["mass"].IsDefined() && config["modal"]["mass"].as<std::string>() == "consistent")
+        settings.massType = MassType::CONSISTENT;
+    auto adaptivityConfig = config["adaptivity"];
+    settings.adaptivity = AdaptivitySettings{};
+    if (adaptivityConfig.IsDefined()) {
+        if (settings.dynamic || settings.explicitDynamic)
+            throw std::runtime_error("The mesh can only be adapted in a static continuation");
+        if (!solverSettings.multigridVertices.empty())
+            throw std::runtime_error("The multigrid preconditioner needs the uniform arch, it cannot be adapted");
+        // A checkpoint is restored onto the mesh of the config, it cannot hold an adapted one
+        if (config["checkpoint"].IsDefined())
+            throw std::runtime_error("Checkpoints cannot be written while the mesh is adapted");
+        // A secondary branch starts on the mesh of the config, not on the adapted one of its bifurcation point
+        if (settings.branchSwitching)
+            throw std::runtime_error("Secondary branches cannot be followed while the mesh is adapted");
+        settings.adaptivity.interval = 1;
+        if (adaptivityConfig["interval"].IsDefined())
+            settings.adaptivity.interval = adaptivityConfig["interval"].as<unsigned int>();
+        settings.adaptivity.rotationTolerance = adaptivityConfig["rotationTolerance"].as<double>();
+        settings.adaptivity.momentTolerance = adaptivityConfig["momentTolerance"].as<double>();
+        settings.adaptivity.coarseningFraction = 0.25;
+        if (adaptivityConfig["coarseningFraction"].IsDefined())
+            settings.adaptivity.coarseningFraction = adaptivityConfig["coarseningFraction"].as<double>();
+        settings.adaptivity.minElementLength = 0;
+        if (adaptivityConfig["minElementLength"].IsDefined())
+            settings.adaptivity.minElementLength = adaptivityConfig["minElementLength"].as<double>();
+        settings.adaptivity.maxElementLength = std::numeric_limits<double>::infinity();
+        if (adaptivityConfig["maxElementLength"].IsDefined())
+            settings.adaptivity.maxElementLength = adaptivityConfig["maxElementLength"].as<double>();
+        settings.adaptivity.maxElements = std::numeric_limits<unsigned int>::max();
+        if (adaptivityConfig["maxElements"].IsDefined())
+            settings.adaptivity.maxElements = adaptivityConfig["maxElements"].as<unsigned int>();
+    }
+    double criticalPointTolerance = 0;
+    if (iteratorConfig["criticalPointTolerance"].IsDefined())
+        criticalPointTolerance = iteratorConfig["criticalPointTolerance"].as<double>();
+    // Switching branches needs the buckling mode of a localized bifurcation point
+    else if (settings.branchSwitching)
+        criticalPointTolerance = 1e-6;
+
+    auto checkpointConfig = config["checkpoint"];
+    if (checkpointConfig.IsDefined()) {
+        settings.checkpointFilename = checkpointConfig["filename"].as<std::string>();
+        settings.checkpointInterval = checkpointConfig["interval"].as<unsigned int>();
+    } else {
+        settings.checkpointInterval = 0;
+    }
+
+    return [=](const std::string &branch) {
+        // A secondary branch always starts new logs
+        Logger logger = Logger(nodeToLog, degreeOfFreedomToLog, branch + logPrefix, resume && branch.empty());
+        auto structure = std::make_unique<Structure>(
+                vertices, elementNodes, properties, boundaryConditions, forceVector, std::move(logger),
+                createLinearSolver(solverSettings, branch), ordering);
+        structure->setCriticalPointTolerance(criticalPointTolerance);
+        if (incrementsToCritical > 0) structure->tuneContinuation(incrementsToCritical);
+        return structure;
+    };
+}
+
+/*
+ * Wraps a factory so the created structure continues from a checkpoint
+ * resume: continue the logs of the checkpointed run instead of starting new ones
+ */
+StructureFactory restoreFrom(StructureFactory factory, const std::string &checkpoint, bool resume) {
+    return [=](const std::string &branch) {
+        auto structure = factory(branch);
+        // A secondary branch starts from its bifurcation point instead
+        if (branch.empty()) structure->restoreCheckpoint(checkpoint, resume);
+        return structure;
+    };
+}
+
+/*
+ * Draws lines between the vertices connected by the given elements
+ */
+void showConnectivity(const std::vector<ElementNodes> &elements) {
+    std::vector<unsigned int> elementVertices;
+    elementVertices.reserve(2 * elements.size());
+    for (const auto &nodes : elements) {
+        elementVertices.push_back(nodes.first);
+        elementVertices.push_back(nodes.second);
+    }
+    graphics_setElements(elementVertices);
+}
+
+/*
+ * Returns the vertices that should currently be drawn
+ */
+std::vector<double> getVertices() {
+    if (!replay) return solver->getSnapshot().vertices;
+    if (replayFrame == 0) return replay->getVertices();
+    return replay->getVertices(replayFrame - 1);
+}
+
+/*
+ * Streams the structure oscillating in the shown mode shape into the curve buffer,
+ * one period per second with an amplitude relative to the view
+ */
+void showMode() {
+    const auto &snapshot = solver->getSnapshot();
+    if (shownMode >= static_cast<int>(snapshot.modes.size())) return;
+    const auto &mode = snapshot.modes[shownMode];
+    const double amplitude = viewWidth / 20 * std::sin(2 * M_PI * glfwGetTime());
+    const auto coordinateCount = snapshot.vertices.size();
+    double *vertices = graphics_mapVertices(coordinateCount);
+    for (int degreeOfFreedom = 0, vertexIndex = 0; degreeOfFreedom < mode.size(); ++degreeOfFreedom) {
+        if ((degreeOfFreedom + 1) % 3 == 0) continue;
+        vertices[vertexIndex] = snapshot.vertices[vertexIndex] + amplitude * mode[degreeOfFreedom];
+        ++vertexIndex;
+    }
+    graphics_commitVertices(coordinateCount);
+}
+
+/*
+ * Streams the current replay frame straight into the curve buffer and prints its values
+ */
+void showReplayFrame() {
+    if (replayFrame == 0) {
+        graphics_updateVertices(replay->getVertices());
+        std::cout << "Increment 0/" << replay->size() << std::endl;
+        return;
+    }
+    const auto coordinateCount = replay->vertexCoordinateCount();
+    replay->writeVertices(replayFrame - 1, graphics_mapVertices(coordinateCount));
+    graphics_commitVertices(coordinateCount);
+
+    const auto &record = replay->record(replayFrame - 1);
+    std::cout << "Increment " << replayFrame << "/" << replay->size()
+              << " loadingParameter: " << record.loadingParameter
+              << " residual: " << record.residualNorm
+              << " iterations: " << record.iterations << std::endl;
+}
+
+/*
+ * Handles scrubbing through the replayed history, returns whether the key was used
+ */
+bool replay_key(int key) {
+    const size_t frameCount = replay->size() + 1;
+    switch (key) {
+        case GLFW_KEY_RIGHT:
+            replayFrame = std::min(replayFrame + 1, frameCount - 1);
+            break;
+        case GLFW_KEY_LEFT:
+            replayFrame = replayFrame > 0 ? replayFrame - 1 : 0;
+            break;
+        case GLFW_KEY_UP:
+            replayFrame = std::min(replayFrame + 10, frameCount - 1);
+            break;
+        case GLFW_KEY_DOWN:
+            replayFrame = replayFrame > 10 ? replayFrame - 10 : 0;
+            break;
+        case GLFW_KEY_HOME:
+            replayFrame = 0;
+            break;
+        case GLFW_KEY_END:
+            replayFrame = frameCount - 1;
+            break;
+        case GLFW_KEY_R:
+            // Maps the file again to include points appended since it was opened,
+            // the previous mapping stays when the file cannot be read
+            try {
+                replay = std::make_unique<HistoryReader>(replayFilename);
+            } catch (const std::exception &error) {
+                std::cout << error.what() << std::endl;
+                return true;
+            }
+            replayFrame = std::min(replayFrame, replay->size());
+            showConnectivity(replay->getConnectivity());
+            graphics_reload();
+            break;
+        case GLFW_KEY_SPACE:
+        case GLFW_KEY_I:
+            // The solver is not used when replaying
+            return true;
+        default:
+            return false;
+    }
+    showReplayFrame();
+    return true;
 }
 
 /*
  * Handles all user input, is called from window_utils.c
  */
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode) {
+    if (replay && (action == GLFW_PRESS || action == GLFW_REPEAT) && replay_key(key)) return;
     if (action == GLFW_PRESS) {
         switch (key) {
             case GLFW_KEY_ESCAPE:
@@ -110,18 +492,33 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
                 glfwSetWindowShouldClose(window, GL_TRUE);
                 break;
             case GLFW_KEY_R:
-                structure = loadStuff();
+                solver->reload(loadStuff(), settings);
+                showConnectivity(connectivity);
+                shownMesh = 0;
                 // Reloads shaders and ui points from shader, vertices and indices files
                 graphics_reload();
                 break;
             case GLFW_KEY_SPACE:
-                if (arclength)
-                    structure->arcLength(stepSize, tolerance, maxIterations);
-                else
-                    structure->newton(stepSize, tolerance, maxIterations);
+                solver->step();
+                break;
+            case GLFW_KEY_S:
+                solver->stop();
+                break;
+            case GLFW_KEY_M:
+                // Cycles through the mode shapes of the current state and back to the structure at rest
+                if (shownMode < 0) {
+                    if (solver->getSnapshot().modes.empty()) solver->modes();
+                    shownMode = 0;
+                } else if (++shownMode >= static_cast<int>(solver->getSnapshot().modes.size())) {
+                    shownMode = -1;
+                    graphics_updateVertices(solver->getSnapshot().vertices);
+                }
+                if (shownMode >= 0 && shownMode < static_cast<int>(solver->getSnapshot().frequencies.size()))
+                    std::cout << "Mode " << shownMode + 1 << ": "
+                              << solver->getSnapshot().frequencies[shownMode] << " Hz" << std::endl;
                 break;
             case GLFW_KEY_0: {
-                std::vector<double> vertices = structure->getVertices();
+                std::vector<double> vertices = getVertices();
                 std::transform(vertices.begin(), vertices.end(), vertices.begin(),
                                std::abs<double>);
 
@@ -129,18 +526,10 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
                         *std::max_element(vertices.begin(), vertices.end()) * 2;
                 break;
             }
-            case GLFW_KEY_I: {
+            case GLFW_KEY_I:
                 //iterate
-                for (int i = 0; i < increments; ++i) {
-                    bool diverging;
-                    if (arclength)
-                        diverging = structure->arcLength(stepSize, tolerance, maxIterations);
-                    else
-                        diverging = structure->newton(stepSize, tolerance, maxIterations);
-                    if (diverging) break;
-                }
+                solver->run(static_cast<unsigned int>(increments));
                 break;
-            }
             case GLFW_KEY_MINUS:
                 viewWidth += initialViewWidth / 20;
                 break;
@@ -156,20 +545,100 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
  * The main function
  */
 int main(int argc, char **argv) {
+    // Converts a history file to the format used by plot.plt: sfems --to-dat <history> <node> <degreeOfFreedom> [output]
+    if (argc >= 5 && std::string(argv[1]) == "--to-dat") {
+        HistoryReader history(argv[2]);
+        writePointsFile(history, std::stoul(argv[3]), std::stoul(argv[4]), argc > 5 ? argv[5] : "historyPoints.dat");
+        return 0;
+    }
+
+    // sfems [--batch] [--restart <checkpoint> | --fork <checkpoint>]
+    // --batch: runs the configured increments without a window
+    // --restart: continues a run from a checkpoint, appending to its logs
+    // --fork: starts a new run with new logs from the state in a checkpoint
+    bool batch = false;
+    std::string restartFilename;
+    bool fork = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--batch") {
+            batch = true;
+        } else if ((argument == "--restart" || argument == "--fork") && i + 1 < argc) {
+            fork = argument == "--fork";
+            restartFilename = argv[++i];
+        }
+    }
+    const bool resume = !restartFilename.empty() && !fork;
+    // sfems --replay <history> shows a stored history instead of calculating
+    const bool replayMode = argc >= 3 && std::string(argv[1]) == "--replay";
+
+    StructureFactory factory;
+    if (!replayMode) {
+        factory = loadStuff(resume);
+        if (!restartFilename.empty()) factory = restoreFrom(factory, restartFilename, resume);
+    }
+
+    if (batch && !replayMode) {
+        auto structure = factory("");
+        BranchRunner branches(factory, settings);
+        while (structure->getIncrement() < increments) {
+            if (runIncrement(*structure, settings)) {
+                std::cout << "Diverged at increment " << structure->getIncrement() << std::endl;
+                return 1;
+            }
+            branches.check(*structure);
+            if (adaptIfDue(structure, settings)) {
+                std::cout << "Lost the equilibrium on the adapted mesh at increment "
+                          << structure->getIncrement() << std::endl;
+                return 1;
+            }
+        }
+        branches.join();
+        return 0;
+    }
+
     // Initializes main modules
     window_init(key_callback);
     graphics_init((void *(*)(const char)) glfwGetProcAddress);
 
-    structure = loadStuff();
+    if (replayMode) {
+        replayFilename = argv[2];
+        replay = std::make_unique<HistoryReader>(replayFilename);
+        std::vector<double> vertices = replay->getVertices();
+        std::transform(vertices.begin(), vertices.end(), vertices.begin(), std::abs<double>);
+        viewWidth = initialViewWidth = *std::max_element(vertices.begin(), vertices.end()) * 2;
+        showConnectivity(replay->getConnectivity());
+        showReplayFrame();
+    } else {
+        // Wakes up the render loop whenever the solver has published a new state
+        solver = std::make_unique<SolverWorker>(glfwPostEmptyEvent);
+        solver->reload(factory, settings);
+        showConnectivity(connectivity);
+    }
 
     while (window_open()) {
-        // Handle input and draw updated values
-        window_update_wait();
-        std::vector<double> rawVertices{structure->getVertices()};
-        std::vector<float> vertices(rawVertices.size());
-        std::transform(rawVertices.begin(), rawVertices.end(), vertices.begin(),
-                       [](double v) { return 2 * v / viewWidth; });
-        graphics_draw(vertices);
+        // Handle input and draw updated values, an animated mode needs to be drawn continuously
+        if (shownMode >= 0) window_update();
+        else window_update_wait();
+        if (solver && solver->updateSnapshot()) {
+            const auto &snapshot = solver->getSnapshot();
+            std::cout << "Increment " << snapshot.increment
+                      << " loadingParameter: " << snapshot.loadingParameter
+                      << " negative pivots: " << snapshot.negativePivots
+                      << (snapshot.busy ? " (running)" : "") << std::endl;
+            for (size_t i = 0; i < snapshot.frequencies.size(); ++i)
+                std::cout << "Mode " << i + 1 << ": " << snapshot.frequencies[i] << " Hz" << std::endl;
+            if (snapshot.mesh != shownMesh) {
+                showConnectivity(snapshot.connectivity);
+                shownMesh = snapshot.mesh;
+            }
+            graphics_updateVertices(snapshot.vertices);
+        }
+        if (solver && shownMode >= 0) showMode();
+        // The vertices are only uploaded when they change, scaling to the view is done in the shader
+        graphics_draw(static_cast<float>(2 / viewWidth));
     }
+    // Stops the solver before the window is gone
+    solver.reset();
     return 0;
 }
@@ -0,0 +1,23 @@
+#include "frame.hpp"
+
+Frame meshFrame(const std::vector<double> &joints, const std::vector<ElementNodes> &members,
+                unsigned int elementsPerMember) {
+    validateConnectivity(members, joints.size() / 2);
+    Frame frame{joints, {}};
+    frame.connectivity.reserve(members.size() * elementsPerMember);
+    for (const auto &member : members) {
+        unsigned int previous = member.first;
+        for (unsigned int i = 1; i < elementsPerMember; ++i) {
+            const double t = static_cast<double>(i) / elementsPerMember;
+            for (int coordinate = 0; coordinate < 2; ++coordinate) {
+                frame.vertices.push_back((1 - t) * joints[2 * member.first + coordinate] +
+                                         t * joints[2 * member.second + coordinate]);
+            }
+            const auto node = static_cast<unsigned int>(frame.vertices.size() / 2 - 1);
+            frame.connectivity.push_back(ElementNodes{previous, node});
+            previous = node;
+        }
+        frame.connectivity.push_back(ElementNodes{previous, member.second});
+    }
+    return frame;
+}
@@ -0,0 +1,20 @@
+#ifndef SFEMS_FRAME_HPP
+#define SFEMS_FRAME_HPP
+
+#include <vector>
+#include "../calculations/connectivity.hpp"
+
+struct Frame {
+    std::vector<double> vertices;
+    std::vector<ElementNodes> connectivity;
+};
+
+/*
+ * Meshes a frame given by its joints and the members between them,
+ * dividing every member into elementsPerMember beam elements.
+ * The joints keep their indices as nodes, the nodes inside the members follow after them.
+ */
+Frame meshFrame(const std::vector<double> &joints, const std::vector<ElementNodes> &members,
+                unsigned int elementsPerMember);
+
+#endif //SFEMS_FRAME_HPP
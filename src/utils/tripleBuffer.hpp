@@ -0,0 +1,41 @@
+#ifndef SFEMS_TRIPLEBUFFER_HPP
+#define SFEMS_TRIPLEBUFFER_HPP
+
+#include <atomic>
+
+/*
+ * Lock-free triple buffer for handing values from one writer thread to one reader thread.
+ * The writer fills writeBuffer() and publishes it, the reader picks up the newest published
+ * value with update() and reads it from readBuffer(). Neither side ever waits for the other,
+ * and intermediate values are dropped if the writer is faster than the reader.
+ */
+template<typename T>
+class TripleBuffer {
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int DIRTY = 4;
+
+    T buffers[3];
+    // Index of the buffer between the writer and the reader, with DIRTY set when it holds a new value
+    std::atomic<unsigned int> middle{1};
+    unsigned int back = 0;
+    unsigned int front = 2;
+
+public:
+    // Writer side
+    T &writeBuffer() { return buffers[back]; }
+
+    void publish() {
+        back = middle.exchange(back | DIRTY, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side, returns whether a new value was picked up
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & DIRTY)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T &readBuffer() const { return buffers[front]; }
+};
+
+#endif //SFEMS_TRIPLEBUFFER_HPP